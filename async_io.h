@@ -0,0 +1,407 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <future>
+#include <memory>
+#include <stdexcept>
+#include <system_error>
+#include <thread>
+#include <type_traits>
+
+#include <sys/types.h>
+#include <unistd.h>
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#define NOTSTD_HAS_IO_URING 1
+#else
+#define NOTSTD_HAS_IO_URING 0
+#endif
+
+#include "vector.h"
+
+namespace notstd {
+    struct AsyncIoOptions {
+        // Bytes per request; rounded to kDirectIoAlignment when direct is set
+        size_t chunk_bytes = size_t(4) << 20;
+        // Requests kept in flight on the ring
+        unsigned queue_depth = 32;
+        // Worker threads of the fallback used when io_uring is unavailable
+        unsigned threads = 4;
+        // The fd was opened with O_DIRECT: the vector storage transferred, the file offset and
+        // the length must all be multiples of kDirectIoAlignment, or the call throws
+        // std::invalid_argument. Ordinary vectors are not page aligned; use DirectIoPage elements.
+        bool direct = false;
+        // Allows forcing the fallback, e.g. where io_uring is disabled by seccomp
+        bool use_io_uring = true;
+    };
+
+    inline constexpr size_t kDirectIoAlignment = 4096;
+
+    // Element type for O_DIRECT transfers: a Vector<DirectIoPage> allocates page-aligned
+    // storage, and any whole number of pages keeps the next append aligned
+    struct alignas(kDirectIoAlignment) DirectIoPage {
+        std::byte bytes[kDirectIoAlignment];
+    };
+
+    namespace async_io_detail {
+        enum class Direction {
+            kRead,
+            kWrite,
+        };
+
+        struct Chunk {
+            std::byte* data;
+            size_t size;
+            off_t offset;
+            size_t done = 0;
+            bool eof = false;
+        };
+
+        [[noreturn]] inline void Throw(int error, const char* what) {
+            throw std::system_error(error, std::generic_category(), what);
+        }
+
+#if NOTSTD_HAS_IO_URING
+        // Minimal single-threaded io_uring driven by raw syscalls, so no liburing is required
+        class IoUring {
+        public:
+            explicit IoUring(unsigned entries) {
+                io_uring_params params;
+                std::memset(&params, 0, sizeof(params));
+                fd_ = static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+                if (fd_ < 0) {
+                    Throw(errno, "io_uring_setup");
+                }
+                try {
+                    MapRings(params);
+                } catch (...) {
+                    Release();
+                    throw;
+                }
+            }
+
+            IoUring(const IoUring&) = delete;
+            IoUring& operator=(const IoUring&) = delete;
+
+            ~IoUring() {
+                Release();
+            }
+
+            bool Push(Direction direction, int fd, void* data, unsigned size, off_t offset, uint64_t user_data) noexcept {
+                unsigned tail = *sq_tail_;
+                if (tail - __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE) == sq_entries_) {
+                    return false;
+                }
+                unsigned index = tail & sq_mask_;
+                io_uring_sqe* sqe = sqes_ + index;
+                std::memset(sqe, 0, sizeof(*sqe));
+                sqe->opcode = direction == Direction::kRead ? IORING_OP_READ : IORING_OP_WRITE;
+                sqe->fd = fd;
+                sqe->addr = reinterpret_cast<uint64_t>(data);
+                sqe->len = size;
+                sqe->off = static_cast<uint64_t>(offset);
+                sqe->user_data = user_data;
+                sq_array_[index] = index;
+                __atomic_store_n(sq_tail_, tail + 1, __ATOMIC_RELEASE);
+                ++unsubmitted_;
+                return true;
+            }
+
+            // Submits queued requests and, if wait is set, blocks until one completion is ready
+            void Submit(bool wait) {
+                for (;;) {
+                    long submitted = syscall(__NR_io_uring_enter, fd_, unsubmitted_, wait ? 1u : 0u,
+                                             wait ? IORING_ENTER_GETEVENTS : 0u, nullptr, 0);
+                    if (submitted >= 0) {
+                        unsubmitted_ -= static_cast<unsigned>(submitted);
+                        return;
+                    }
+                    if (errno != EINTR) {
+                        Throw(errno, "io_uring_enter");
+                    }
+                }
+            }
+
+            bool Pop(uint64_t& user_data, int& result) noexcept {
+                unsigned head = *cq_head_;
+                if (head == __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE)) {
+                    return false;
+                }
+                const io_uring_cqe& cqe = cqes_[head & cq_mask_];
+                user_data = cqe.user_data;
+                result = cqe.res;
+                __atomic_store_n(cq_head_, head + 1, __ATOMIC_RELEASE);
+                return true;
+            }
+
+        private:
+            void MapRings(const io_uring_params& params) {
+                sq_entries_ = params.sq_entries;
+                size_t sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+                size_t cq_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+                bool single_mmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+                if (single_mmap) {
+                    sq_size = cq_size = std::max(sq_size, cq_size);
+                }
+                sq_ring_size_ = sq_size;
+                sq_ring_ = Map(sq_size, IORING_OFF_SQ_RING);
+                if (single_mmap) {
+                    cq_ring_ = sq_ring_;
+                } else {
+                    cq_ring_size_ = cq_size;
+                    cq_ring_ = Map(cq_size, IORING_OFF_CQ_RING);
+                }
+                sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+                sqes_ = static_cast<io_uring_sqe*>(Map(sqes_size_, IORING_OFF_SQES));
+
+                auto* sq = static_cast<char*>(sq_ring_);
+                sq_head_ = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+                sq_tail_ = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+                sq_mask_ = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+                sq_array_ = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+                auto* cq = static_cast<char*>(cq_ring_);
+                cq_head_ = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+                cq_tail_ = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+                cq_mask_ = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+                cqes_ = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+            }
+
+            void Release() noexcept {
+                if (sqes_ != nullptr) {
+                    munmap(sqes_, sqes_size_);
+                }
+                if (cq_ring_ != nullptr && cq_ring_ != sq_ring_) {
+                    munmap(cq_ring_, cq_ring_size_);
+                }
+                if (sq_ring_ != nullptr) {
+                    munmap(sq_ring_, sq_ring_size_);
+                }
+                if (fd_ >= 0) {
+                    close(fd_);
+                }
+            }
+
+            void* Map(size_t size, off_t offset) {
+                void* address = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_, offset);
+                if (address == MAP_FAILED) {
+                    Throw(errno, "io_uring mmap");
+                }
+                return address;
+            }
+
+        private:
+            int fd_ = -1;
+            unsigned sq_entries_ = 0;
+            unsigned unsubmitted_ = 0;
+            void* sq_ring_ = nullptr;
+            void* cq_ring_ = nullptr;
+            size_t sq_ring_size_ = 0;
+            size_t cq_ring_size_ = 0;
+            io_uring_sqe* sqes_ = nullptr;
+            size_t sqes_size_ = 0;
+            unsigned* sq_head_ = nullptr;
+            unsigned* sq_tail_ = nullptr;
+            unsigned* sq_array_ = nullptr;
+            unsigned sq_mask_ = 0;
+            unsigned* cq_head_ = nullptr;
+            unsigned* cq_tail_ = nullptr;
+            unsigned cq_mask_ = 0;
+            io_uring_cqe* cqes_ = nullptr;
+        };
+
+        // Returns false if a ring could not be created or the kernel predates IORING_OP_READ
+        // and IORING_OP_WRITE (5.6), leaving the work to the fallback. On an I/O error it stops
+        // queueing but waits for every request still in flight before throwing, since the
+        // kernel may still be copying into or out of the caller's buffer.
+        inline bool RunOnRing(Direction direction, int fd, Vector<Chunk>& chunks, unsigned depth) {
+            std::unique_ptr<IoUring> ring;
+            try {
+                ring = std::make_unique<IoUring>(depth);
+            } catch (const std::system_error&) {
+                return false;
+            }
+            size_t next = 0;
+            size_t in_flight = 0;
+            Vector<size_t> retry;
+            auto push = [&](size_t index) {
+                Chunk& chunk = chunks[index];
+                size_t left = chunk.size - chunk.done;
+                unsigned size = static_cast<unsigned>(std::min<size_t>(left, 1u << 30));
+                if (!ring->Push(direction, fd, chunk.data + chunk.done, size, chunk.offset + static_cast<off_t>(chunk.done), index)) {
+                    return false;
+                }
+                ++in_flight;
+                return true;
+            };
+            int error = 0;
+            bool completed_any = false;
+            bool unsupported = false;
+            while (in_flight != 0 || (error == 0 && (next < chunks.Size() || retry.Size() != 0))) {
+                while (error == 0 && retry.Size() != 0 && in_flight < depth && push(retry[retry.Size() - 1])) {
+                    retry.PopBack();
+                }
+                while (error == 0 && retry.Size() == 0 && next < chunks.Size() && in_flight < depth && push(next)) {
+                    ++next;
+                }
+                ring->Submit(in_flight != 0);
+                uint64_t index;
+                int result;
+                while (ring->Pop(index, result)) {
+                    --in_flight;
+                    bool first = !completed_any;
+                    completed_any = true;
+                    Chunk& chunk = chunks[index];
+                    if (result == -EINTR || result == -EAGAIN) {
+                        retry.PushBack(index);
+                    } else if (result < 0) {
+                        unsupported = unsupported || (first && (result == -EINVAL || result == -EOPNOTSUPP));
+                        error = error == 0 ? -result : error;
+                    } else if (result == 0) {
+                        chunk.eof = true;
+                    } else {
+                        chunk.done += static_cast<size_t>(result);
+                        if (chunk.done < chunk.size) {
+                            retry.PushBack(index);
+                        }
+                    }
+                }
+            }
+            if (unsupported) {
+                // whatever did complete is simply transferred again by the fallback
+                for (Chunk& chunk : chunks) {
+                    chunk.done = 0;
+                    chunk.eof = false;
+                }
+                return false;
+            }
+            if (error != 0) {
+                Throw(error, direction == Direction::kRead ? "io_uring read" : "io_uring write");
+            }
+            return true;
+        }
+#endif
+
+        inline void RunChunk(Direction direction, int fd, Chunk& chunk) {
+            while (chunk.done < chunk.size) {
+                ssize_t result = direction == Direction::kRead
+                    ? pread(fd, chunk.data + chunk.done, chunk.size - chunk.done, chunk.offset + static_cast<off_t>(chunk.done))
+                    : pwrite(fd, chunk.data + chunk.done, chunk.size - chunk.done, chunk.offset + static_cast<off_t>(chunk.done));
+                if (result < 0) {
+                    if (errno == EINTR) {
+                        continue;
+                    }
+                    Throw(errno, direction == Direction::kRead ? "pread" : "pwrite");
+                }
+                if (result == 0) {
+                    chunk.eof = true;
+                    return;
+                }
+                chunk.done += static_cast<size_t>(result);
+            }
+        }
+
+        inline void RunOnThreads(Direction direction, int fd, Vector<Chunk>& chunks, unsigned threads) {
+            std::atomic<size_t> next{0};
+            // set by the first worker that fails, so the others stop taking chunks
+            std::atomic<bool> failed{false};
+            auto worker = [&] {
+                for (size_t index = next++; index < chunks.Size() && !failed.load(std::memory_order_relaxed); index = next++) {
+                    try {
+                        RunChunk(direction, fd, chunks[index]);
+                    } catch (...) {
+                        failed.store(true, std::memory_order_relaxed);
+                        throw;
+                    }
+                }
+            };
+            threads = std::max(1u, std::min<unsigned>(threads, static_cast<unsigned>(chunks.Size())));
+            Vector<std::future<void>> workers;
+            workers.Reserve(threads - 1);
+            for (unsigned i = 1; i < threads; ++i) {
+                workers.PushBack(std::async(std::launch::async, worker));
+            }
+            worker();
+            for (std::future<void>& w : workers) {
+                w.get();
+            }
+        }
+
+        inline Vector<Chunk> Split(std::byte* data, size_t size, off_t offset, const AsyncIoOptions& options) {
+            size_t chunk_bytes = std::max<size_t>(options.chunk_bytes, 1);
+            if (options.direct) {
+                chunk_bytes = (chunk_bytes + kDirectIoAlignment - 1) / kDirectIoAlignment * kDirectIoAlignment;
+                if (reinterpret_cast<uintptr_t>(data) % kDirectIoAlignment != 0
+                    || static_cast<size_t>(offset) % kDirectIoAlignment != 0
+                    || size % kDirectIoAlignment != 0) {
+                    throw std::invalid_argument("O_DIRECT transfer requires kDirectIoAlignment-aligned storage, offset and length");
+                }
+            }
+            Vector<Chunk> chunks;
+            chunks.Reserve((size + chunk_bytes - 1) / chunk_bytes);
+            for (size_t done = 0; done < size; done += chunk_bytes) {
+                chunks.PushBack(Chunk{data + done, std::min(chunk_bytes, size - done), offset + static_cast<off_t>(done)});
+            }
+            return chunks;
+        }
+
+        inline void Run(Direction direction, int fd, Vector<Chunk>& chunks, const AsyncIoOptions& options) {
+#if NOTSTD_HAS_IO_URING
+            if (options.use_io_uring && RunOnRing(direction, fd, chunks, std::max(1u, options.queue_depth))) {
+                return;
+            }
+#endif
+            RunOnThreads(direction, fd, chunks, options.threads);
+        }
+
+        // Bytes transferred before the first chunk that stopped short
+        inline size_t ContiguousBytes(const Vector<Chunk>& chunks) noexcept {
+            size_t total = 0;
+            for (const Chunk& chunk : chunks) {
+                total += chunk.done;
+                if (chunk.done != chunk.size) {
+                    break;
+                }
+            }
+            return total;
+        }
+    }//namespace async_io_detail
+
+    // Appends count elements read from fd at offset to out, using parallel chunked reads
+    // straight into its reserved storage. The future yields the number of elements appended,
+    // fewer than count if the file ends early. out must not be touched until the future is ready.
+    // With options.direct, reads land at out.Data() + out.Size() after reserving, which must be
+    // kDirectIoAlignment-aligned; see DirectIoPage.
+    template <typename T>
+    std::future<size_t> AsyncLoad(int fd, Vector<T>& out, size_t count, off_t offset, AsyncIoOptions options = {}) {
+        static_assert(std::is_trivially_copyable_v<T>, "only trivially copyable elements can be loaded raw");
+        out.Reserve(out.Size() + count);
+        auto* data = reinterpret_cast<std::byte*>(out.SpareCapacity().Data());
+        Vector<async_io_detail::Chunk> chunks = async_io_detail::Split(data, count * sizeof(T), offset, options);
+        return std::async(std::launch::async, [fd, &out, options, chunks = std::move(chunks)]() mutable {
+            async_io_detail::Run(async_io_detail::Direction::kRead, fd, chunks, options);
+            size_t loaded = async_io_detail::ContiguousBytes(chunks) / sizeof(T);
+            out.CommitAppend(loaded);
+            return loaded;
+        });
+    }
+
+    // Writes all elements of in to fd at offset using parallel chunked writes. The future
+    // yields the number of bytes written; in must stay alive and unmodified until it is ready.
+    // With options.direct, in.Data() must be kDirectIoAlignment-aligned; see DirectIoPage.
+    template <typename T>
+    std::future<size_t> AsyncSave(int fd, const Vector<T>& in, off_t offset, AsyncIoOptions options = {}) {
+        static_assert(std::is_trivially_copyable_v<T>, "only trivially copyable elements can be saved raw");
+        auto* data = const_cast<std::byte*>(reinterpret_cast<const std::byte*>(in.Data()));
+        Vector<async_io_detail::Chunk> chunks = async_io_detail::Split(data, in.Size() * sizeof(T), offset, options);
+        return std::async(std::launch::async, [fd, options, chunks = std::move(chunks)]() mutable {
+            async_io_detail::Run(async_io_detail::Direction::kWrite, fd, chunks, options);
+            return async_io_detail::ContiguousBytes(chunks);
+        });
+    }
+}//namespace notstd
@@ -0,0 +1,298 @@
+// Shared pieces of the container benchmarks: cycle timer, core pinning, an HDR-style
+// latency histogram and a CSV/JSON report writer for regression comparison.
+#pragma once
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <utility>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+#if defined(__linux__)
+#include <sched.h>
+#endif
+
+#include "../vector.h"
+
+namespace bench {
+    using notstd::Vector;
+
+    // Timestamp in ticks: the TSC on x86 (rdtscp waits for earlier instructions to retire),
+    // steady_clock nanoseconds elsewhere. Convert with TicksPerNs().
+    inline uint64_t Ticks() noexcept {
+#if defined(__x86_64__) || defined(__i386__)
+        unsigned aux;
+        return __rdtscp(&aux);
+#else
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+    }
+
+    // Calibrated once against steady_clock
+    inline double TicksPerNs() {
+        static const double ratio = [] {
+            auto wall_start = std::chrono::steady_clock::now();
+            uint64_t start = Ticks();
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            uint64_t end = Ticks();
+            std::chrono::duration<double, std::nano> wall = std::chrono::steady_clock::now() - wall_start;
+            return static_cast<double>(end - start) / wall.count();
+        }();
+        return ratio;
+    }
+
+    // Pins the calling thread to one CPU so migrations and frequency differences between
+    // cores do not show up as latency; returns false when not permitted or not supported
+    inline bool PinToCore(int core) noexcept {
+#if defined(__linux__)
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(core, &set);
+        return sched_setaffinity(0, sizeof(set), &set) == 0;
+#else
+        (void)core;
+        return false;
+#endif
+    }
+
+    // Log-linear histogram in the style of HdrHistogram: values below 2^kSubBucketBits are
+    // exact, larger ones land in one of 2^kSubBucketBits buckets per power of two, so every
+    // reported percentile is within 1 / 2^kSubBucketBits (under 1%) of the recorded value.
+    class LatencyHistogram {
+    public:
+        static constexpr int kSubBucketBits = 7;
+        static constexpr uint64_t kSubBuckets = uint64_t(1) << kSubBucketBits;
+
+        LatencyHistogram()
+            : counts_((64 - kSubBucketBits + 1) * kSubBuckets) {
+        }
+
+        void Record(uint64_t value) noexcept {
+            ++counts_[IndexOf(value)];
+            ++count_;
+            sum_ += static_cast<double>(value);
+            max_ = value > max_ ? value : max_;
+            min_ = value < min_ ? value : min_;
+        }
+
+        void Merge(const LatencyHistogram& other) noexcept {
+            for (size_t i = 0; i < counts_.Size(); ++i) {
+                counts_[i] += other.counts_[i];
+            }
+            count_ += other.count_;
+            sum_ += other.sum_;
+            max_ = other.max_ > max_ ? other.max_ : max_;
+            min_ = other.min_ < min_ ? other.min_ : min_;
+        }
+
+        void Reset() noexcept {
+            counts_.Fill(0);
+            count_ = 0;
+            sum_ = 0;
+            max_ = 0;
+            min_ = UINT64_MAX;
+        }
+
+        // Smallest recorded value v such that percent% of the values are <= v
+        uint64_t ValueAtPercentile(double percent) const noexcept {
+            if (count_ == 0) {
+                return 0;
+            }
+            uint64_t target = static_cast<uint64_t>(std::ceil(percent / 100.0 * static_cast<double>(count_)));
+            target = target == 0 ? 1 : target;
+            uint64_t seen = 0;
+            for (size_t i = 0; i < counts_.Size(); ++i) {
+                seen += counts_[i];
+                if (seen >= target) {
+                    uint64_t value = HighestEquivalent(i);
+                    return value < max_ ? value : max_;
+                }
+            }
+            return max_;
+        }
+
+        uint64_t Count() const noexcept {
+            return count_;
+        }
+
+        uint64_t Max() const noexcept {
+            return max_;
+        }
+
+        uint64_t Min() const noexcept {
+            return count_ == 0 ? 0 : min_;
+        }
+
+        double Mean() const noexcept {
+            return count_ == 0 ? 0 : sum_ / static_cast<double>(count_);
+        }
+
+    private:
+        static size_t IndexOf(uint64_t value) noexcept {
+            if (value < kSubBuckets) {
+                return static_cast<size_t>(value);
+            }
+            int shift = 63 - __builtin_clzll(value) - kSubBucketBits;
+            return static_cast<size_t>((shift + 1) * kSubBuckets + ((value >> shift) - kSubBuckets));
+        }
+
+        static uint64_t HighestEquivalent(size_t index) noexcept {
+            if (index < kSubBuckets) {
+                return index;
+            }
+            int shift = static_cast<int>(index / kSubBuckets) - 1;
+            uint64_t low = (kSubBuckets + index % kSubBuckets) << shift;
+            return low + ((uint64_t(1) << shift) - 1);
+        }
+
+    private:
+        Vector<uint64_t> counts_;
+        uint64_t count_ = 0;
+        double sum_ = 0;
+        uint64_t max_ = 0;
+        uint64_t min_ = UINT64_MAX;
+    };
+
+    // One result row: ordered columns, numbers or strings. NaN numbers mean "not measured"
+    // and are written as empty CSV fields and JSON nulls.
+    class Row {
+    public:
+        Row& Set(std::string column, std::string value) {
+            columns_.PushBack(Column{std::move(column), std::move(value), false});
+            return *this;
+        }
+
+        Row& Set(std::string column, double value) {
+            char text[64] = "";
+            if (!std::isnan(value)) {
+                std::snprintf(text, sizeof(text), "%.6g", value);
+            }
+            columns_.PushBack(Column{std::move(column), text, true});
+            return *this;
+        }
+
+        // p50/p99/p99.9/max/mean columns of a histogram of ticks, converted to nanoseconds
+        Row& SetLatency(const LatencyHistogram& histogram) {
+            double scale = 1.0 / TicksPerNs();
+            Set("count", static_cast<double>(histogram.Count()));
+            Set("p50_ns", histogram.ValueAtPercentile(50) * scale);
+            Set("p99_ns", histogram.ValueAtPercentile(99) * scale);
+            Set("p999_ns", histogram.ValueAtPercentile(99.9) * scale);
+            Set("max_ns", histogram.Max() * scale);
+            Set("mean_ns", histogram.Mean() * scale);
+            return *this;
+        }
+
+    private:
+        friend class Report;
+
+        struct Column {
+            std::string name;
+            std::string value;
+            bool numeric;
+        };
+
+        Vector<Column> columns_;
+    };
+
+    // Collects rows and writes them as CSV (header from the first row, "# key=value" metadata
+    // lines first) or as one JSON object {"meta": {...}, "results": [...]}
+    class Report {
+    public:
+        enum class Format {
+            kCsv,
+            kJson,
+        };
+
+        explicit Report(Format format, std::FILE* out = stdout)
+            : format_(format)
+            , out_(out) {
+        }
+
+        void SetMeta(std::string key, std::string value) {
+            meta_.EmplaceBack(std::move(key), std::move(value));
+        }
+
+        void Add(Row row) {
+            rows_.PushBack(std::move(row));
+        }
+
+        void Write() const {
+            if (format_ == Format::kCsv) {
+                WriteCsv();
+            } else {
+                WriteJson();
+            }
+            std::fflush(out_);
+        }
+
+    private:
+        void WriteCsv() const {
+            for (const auto& [key, value] : meta_) {
+                std::fprintf(out_, "# %s=%s\n", key.c_str(), value.c_str());
+            }
+            if (rows_.Size() == 0) {
+                return;
+            }
+            const char* separator = "";
+            for (const Row::Column& column : rows_[0].columns_) {
+                std::fprintf(out_, "%s%s", separator, column.name.c_str());
+                separator = ",";
+            }
+            std::fputc('\n', out_);
+            for (const Row& row : rows_) {
+                separator = "";
+                for (const Row::Column& column : row.columns_) {
+                    std::fprintf(out_, "%s%s", separator, column.value.c_str());
+                    separator = ",";
+                }
+                std::fputc('\n', out_);
+            }
+        }
+
+        void WriteJson() const {
+            std::fprintf(out_, "{\"meta\": {");
+            const char* separator = "";
+            for (const auto& [key, value] : meta_) {
+                std::fprintf(out_, "%s\"%s\": \"%s\"", separator, key.c_str(), value.c_str());
+                separator = ", ";
+            }
+            std::fprintf(out_, "},\n \"results\": [");
+            const char* row_separator = "\n  ";
+            for (const Row& row : rows_) {
+                std::fprintf(out_, "%s{", row_separator);
+                separator = "";
+                for (const Row::Column& column : row.columns_) {
+                    if (column.numeric) {
+                        std::fprintf(out_, "%s\"%s\": %s", separator, column.name.c_str(),
+                                     column.value.empty() ? "null" : column.value.c_str());
+                    } else {
+                        std::fprintf(out_, "%s\"%s\": \"%s\"", separator, column.name.c_str(), column.value.c_str());
+                    }
+                    separator = ", ";
+                }
+                std::fprintf(out_, "}");
+                row_separator = ",\n  ";
+            }
+            std::fprintf(out_, "\n]}\n");
+        }
+
+    private:
+        Format format_;
+        std::FILE* out_;
+        Vector<std::pair<std::string, std::string>> meta_;
+        Vector<Row> rows_;
+    };
+
+    // Keeps the optimizer from discarding a computed value
+    template <typename T>
+    inline void DoNotOptimize(const T& value) noexcept {
+        asm volatile("" : : "r,m"(value) : "memory");
+    }
+}//namespace bench
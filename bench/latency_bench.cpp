@@ -0,0 +1,234 @@
+// Per-operation tail latency of container operations, to catch growth spikes that
+// throughput numbers average away. Every call is timed on its own and recorded in a
+// histogram; each row reports p50/p99/p99.9/max per element type, growth policy and op.
+// Where perf_event_open is permitted, rows also carry hardware counters per operation,
+// covering the whole timed loop (value construction and the timer included).
+//
+// Build: g++ -std=c++17 -O2 -I.. latency_bench.cpp -o latency_bench
+// Usage: latency_bench [--csv|--json] [--core N] [--scale F]
+// Compare runs by diffing the CSV output or loading the JSON into a notebook.
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+
+#include "../incremental_vector.h"
+#include "../segmented_vector.h"
+#include "../vector.h"
+#include "bench_support.h"
+#include "perf_counters.h"
+
+namespace {
+    using bench::LatencyHistogram;
+    using bench::Ticks;
+    using notstd::IncrementalVector;
+    using notstd::SegmentedVector;
+    using notstd::Vector;
+
+    struct Blob64 {
+        uint64_t words[8];
+    };
+
+    template <typename T>
+    T MakeValue(size_t i) {
+        if constexpr (std::is_same_v<T, std::string>) {
+            // longer than the small-string buffer, so copies allocate
+            return std::string(32, static_cast<char>('a' + i % 26));
+        } else if constexpr (std::is_same_v<T, Blob64>) {
+            Blob64 blob{};
+            blob.words[0] = i;
+            return blob;
+        } else {
+            return static_cast<T>(i);
+        }
+    }
+
+    template <typename T>
+    const char* TypeName() {
+        if constexpr (std::is_same_v<T, std::string>) {
+            return "string32";
+        } else if constexpr (std::is_same_v<T, Blob64>) {
+            return "blob64";
+        } else {
+            return "uint64";
+        }
+    }
+
+    bench::PerfCounters& Counters() {
+        static bench::PerfCounters counters;
+        return counters;
+    }
+
+    bench::Row MakeRow(const char* op, const char* type, const char* policy, const LatencyHistogram& histogram,
+                       const bench::PerfCounters::Sample& sample) {
+        bench::Row row;
+        row.Set("op", op).Set("type", type).Set("policy", policy).SetLatency(histogram);
+        bench::PerfCounters::AddColumns(row, sample, static_cast<double>(histogram.Count()));
+        return row;
+    }
+
+    template <typename F>
+    uint64_t Time(F&& op) {
+        uint64_t start = Ticks();
+        op();
+        return Ticks() - start;
+    }
+
+    struct Config {
+        size_t pushes = 1'000'000;
+        size_t middle_ops = 20'000;
+        size_t reserve_calls = 2'000;
+        size_t copy_size = 100'000;
+        size_t copies = 200;
+    };
+
+    // EmplaceBack under each growth policy: doubling Vector, Vector reserved up front,
+    // de-amortized IncrementalVector and never-relocating SegmentedVector
+    template <typename T>
+    void EmplaceBackRows(const Config& config, bench::Report& report) {
+        auto run = [&](const char* policy, auto& container, auto&& prepare) {
+            LatencyHistogram histogram;
+            prepare();
+            Counters().Start();
+            for (size_t i = 0; i < config.pushes; ++i) {
+                T value = MakeValue<T>(i);
+                histogram.Record(Time([&] { container.EmplaceBack(std::move(value)); }));
+            }
+            report.Add(MakeRow("EmplaceBack", TypeName<T>(), policy, histogram, Counters().Stop()));
+        };
+        {
+            Vector<T> vector;
+            run("doubling", vector, [] {});
+        }
+        {
+            Vector<T> vector;
+            run("reserved", vector, [&] { vector.Reserve(config.pushes); });
+        }
+        {
+            IncrementalVector<T> vector;
+            run("incremental", vector, [] {});
+        }
+        {
+            SegmentedVector<T> vector;
+            run("segmented", vector, [] {});
+        }
+    }
+
+    // Emplace at and Erase from random positions of a vector of middle_ops elements
+    template <typename T>
+    void MiddleRows(const Config& config, bench::Report& report) {
+        std::mt19937_64 rng(42);
+        Vector<T> vector;
+        LatencyHistogram emplace;
+        Counters().Start();
+        for (size_t i = 0; i < config.middle_ops; ++i) {
+            size_t position = rng() % (vector.Size() + 1);
+            T value = MakeValue<T>(i);
+            emplace.Record(Time([&] { vector.Emplace(vector.begin() + position, std::move(value)); }));
+        }
+        report.Add(MakeRow("Emplace", TypeName<T>(), "doubling", emplace, Counters().Stop()));
+        LatencyHistogram erase;
+        Counters().Start();
+        while (vector.Size() != 0) {
+            size_t position = rng() % vector.Size();
+            erase.Record(Time([&] { vector.Erase(vector.begin() + position); }));
+        }
+        report.Add(MakeRow("Erase", TypeName<T>(), "doubling", erase, Counters().Stop()));
+    }
+
+    // Reserve that doubles a full vector, i.e. the relocation EmplaceBack does on growth
+    template <typename T>
+    void ReserveRows(const Config& config, bench::Report& report) {
+        // only the Reserve calls are inside the counter windows; filling the vectors is not
+        LatencyHistogram histogram;
+        bench::PerfCounters::Sample total{};
+        for (size_t call = 0; call < config.reserve_calls; ++call) {
+            size_t size = size_t(1) << (4 + call % 12);
+            Vector<T> vector;
+            vector.Reserve(size);
+            for (size_t i = 0; i < size; ++i) {
+                vector.EmplaceBack(MakeValue<T>(i));
+            }
+            Counters().Start();
+            histogram.Record(Time([&] { vector.Reserve(size * 2); }));
+            bench::PerfCounters::Sample sample = Counters().Stop();
+            for (int counter = 0; counter < bench::PerfCounters::kCounterCount; ++counter) {
+                total.values[counter] += sample.values[counter];
+            }
+        }
+        report.Add(MakeRow("Reserve", TypeName<T>(), "x2", histogram, total));
+    }
+
+    template <typename T>
+    void CopyRows(const Config& config, bench::Report& report) {
+        Vector<T> source;
+        for (size_t i = 0; i < config.copy_size; ++i) {
+            source.EmplaceBack(MakeValue<T>(i));
+        }
+        LatencyHistogram histogram;
+        Counters().Start();
+        for (size_t i = 0; i < config.copies; ++i) {
+            histogram.Record(Time([&] {
+                Vector<T> copy(source);
+                bench::DoNotOptimize(copy.Data());
+            }));
+        }
+        report.Add(MakeRow("Copy", TypeName<T>(), "exact", histogram, Counters().Stop()));
+    }
+
+    template <typename T>
+    void AllRows(const Config& config, bench::Report& report) {
+        EmplaceBackRows<T>(config, report);
+        MiddleRows<T>(config, report);
+        ReserveRows<T>(config, report);
+        CopyRows<T>(config, report);
+    }
+}
+
+int main(int argc, char** argv) {
+    bench::Report::Format format = bench::Report::Format::kCsv;
+    int core = 0;
+    double scale = 1.0;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--json") == 0) {
+            format = bench::Report::Format::kJson;
+        } else if (std::strcmp(argv[i], "--csv") == 0) {
+            format = bench::Report::Format::kCsv;
+        } else if (std::strcmp(argv[i], "--core") == 0 && i + 1 < argc) {
+            core = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--scale") == 0 && i + 1 < argc) {
+            scale = std::atof(argv[++i]);
+        } else {
+            std::fprintf(stderr, "usage: %s [--csv|--json] [--core N] [--scale F]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    Config config;
+    config.pushes = static_cast<size_t>(config.pushes * scale);
+    config.middle_ops = static_cast<size_t>(config.middle_ops * scale);
+    config.reserve_calls = static_cast<size_t>(config.reserve_calls * scale);
+    config.copies = static_cast<size_t>(config.copies * scale);
+
+    bench::Report report(format);
+    bool pinned = bench::PinToCore(core);
+    report.SetMeta("pinned_core", pinned ? std::to_string(core) : "none");
+    report.SetMeta("ticks_per_ns", std::to_string(bench::TicksPerNs()));
+    report.SetMeta("scale", std::to_string(scale));
+    report.SetMeta("perf_counters", Counters().AnyAvailable() ? "available" : "unavailable");
+
+    // cost of the timing itself, to read the other rows against
+    LatencyHistogram timer;
+    Counters().Start();
+    for (int i = 0; i < 100'000; ++i) {
+        timer.Record(Time([] {}));
+    }
+    report.Add(MakeRow("timer", "-", "-", timer, Counters().Stop()));
+
+    AllRows<uint64_t>(config, report);
+    AllRows<Blob64>(config, report);
+    AllRows<std::string>(config, report);
+    report.Write();
+    return 0;
+}
@@ -0,0 +1,503 @@
+// Memory footprint of building, churning and shrinking vectors under each growth policy
+// and allocator configuration. Memory is the binding limit on some hosts, and the last
+// doubling of a Vector briefly holds the old buffer, the new one and the slack: up to 3x
+// the live data.
+//
+// A counting global operator new/delete tracks live and peak heap bytes (as
+// malloc_usable_size sees them) and allocation counts; /proc/self/statm and VmHWM give
+// resident memory. Every scenario runs in a forked child, so RSS starts from the same
+// baseline and what one allocator configuration leaves behind cannot skew the next.
+// RSS columns are deltas from the child's baseline; overhead_bytes is RSS not explained
+// by live heap bytes, i.e. fragmentation plus free memory the allocator keeps cached
+// (negative while capacity has been allocated but not yet touched). peak_over_payload
+// compares the phase's peak with the payload left at its end.
+//
+// Build: g++ -std=c++17 -O2 -I.. memory_bench.cpp -o memory_bench
+// Usage: memory_bench [--csv|--json] [--scale F]
+// Linux with glibc only.
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <random>
+#include <string>
+
+#include <malloc.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "../chunked_builder.h"
+#include "../compactor.h"
+#include "../incremental_vector.h"
+#include "../segmented_vector.h"
+#include "../vector.h"
+#include "../vector_pool.h"
+#include "bench_support.h"
+
+namespace {
+    // The benchmark is single-threaded, so plain counters are enough
+    size_t g_live_bytes = 0;
+    size_t g_peak_live_bytes = 0;
+    size_t g_allocations = 0;
+
+    void* CountedAllocate(size_t size, size_t alignment) noexcept {
+        size = size == 0 ? 1 : size;
+        void* result = nullptr;
+        if (alignment <= alignof(std::max_align_t)) {
+            result = std::malloc(size);
+        } else if (posix_memalign(&result, alignment, size) != 0) {
+            result = nullptr;
+        }
+        if (result != nullptr) {
+            g_live_bytes += malloc_usable_size(result);
+            g_peak_live_bytes = g_live_bytes > g_peak_live_bytes ? g_live_bytes : g_peak_live_bytes;
+            ++g_allocations;
+        }
+        return result;
+    }
+
+    void* CountedAllocateOrThrow(size_t size, size_t alignment) {
+        void* result = CountedAllocate(size, alignment);
+        if (result == nullptr) {
+            throw std::bad_alloc();
+        }
+        return result;
+    }
+
+    void CountedFree(void* pointer) noexcept {
+        if (pointer != nullptr) {
+            g_live_bytes -= malloc_usable_size(pointer);
+            std::free(pointer);
+        }
+    }
+}
+
+void* operator new(size_t size) {
+    return CountedAllocateOrThrow(size, 0);
+}
+
+void* operator new[](size_t size) {
+    return CountedAllocateOrThrow(size, 0);
+}
+
+void* operator new(size_t size, std::align_val_t alignment) {
+    return CountedAllocateOrThrow(size, static_cast<size_t>(alignment));
+}
+
+void* operator new[](size_t size, std::align_val_t alignment) {
+    return CountedAllocateOrThrow(size, static_cast<size_t>(alignment));
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+    return CountedAllocate(size, 0);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept {
+    return CountedAllocate(size, 0);
+}
+
+void operator delete(void* pointer) noexcept {
+    CountedFree(pointer);
+}
+
+void operator delete[](void* pointer) noexcept {
+    CountedFree(pointer);
+}
+
+void operator delete(void* pointer, size_t) noexcept {
+    CountedFree(pointer);
+}
+
+void operator delete[](void* pointer, size_t) noexcept {
+    CountedFree(pointer);
+}
+
+void operator delete(void* pointer, std::align_val_t) noexcept {
+    CountedFree(pointer);
+}
+
+void operator delete[](void* pointer, std::align_val_t) noexcept {
+    CountedFree(pointer);
+}
+
+void operator delete(void* pointer, size_t, std::align_val_t) noexcept {
+    CountedFree(pointer);
+}
+
+void operator delete[](void* pointer, size_t, std::align_val_t) noexcept {
+    CountedFree(pointer);
+}
+
+namespace {
+    using notstd::ChunkedBuilder;
+    using notstd::Compactor;
+    using notstd::IncrementalVector;
+    using notstd::SegmentedVector;
+    using notstd::Vector;
+    using notstd::VectorPool;
+
+    size_t ResidentBytes() {
+        size_t pages = 0;
+        size_t resident = 0;
+        if (std::FILE* file = std::fopen("/proc/self/statm", "r")) {
+            if (std::fscanf(file, "%zu %zu", &pages, &resident) != 2) {
+                resident = 0;
+            }
+            std::fclose(file);
+        }
+        return resident * static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    }
+
+    // VmHWM, or 0 when unavailable
+    size_t PeakResidentBytes() {
+        size_t kilobytes = 0;
+        if (std::FILE* file = std::fopen("/proc/self/status", "r")) {
+            char line[256];
+            while (std::fgets(line, sizeof(line), file) != nullptr) {
+                if (std::sscanf(line, "VmHWM: %zu kB", &kilobytes) == 1) {
+                    break;
+                }
+            }
+            std::fclose(file);
+        }
+        return kilobytes * 1024;
+    }
+
+    // Resets VmHWM to the current RSS (Linux 4.0+); returns false when not supported
+    bool ResetPeakResident() {
+        std::FILE* file = std::fopen("/proc/self/clear_refs", "w");
+        if (file == nullptr) {
+            return false;
+        }
+        bool ok = std::fputs("5", file) >= 0;
+        return std::fclose(file) == 0 && ok;
+    }
+
+    enum class Allocator {
+        // glibc defaults: the mmap threshold adapts upwards as large blocks are freed
+        kMalloc,
+        // fixed 64 KiB mmap threshold, so large buffers always go back to the OS on free
+        kMmap64k,
+        // glibc defaults, but churn recycles vectors through a VectorPool instead of freeing
+        // them, so the row compares against kMalloc alone
+        kPool,
+    };
+
+    const char* AllocatorName(Allocator allocator) {
+        switch (allocator) {
+            case Allocator::kMalloc:
+                return "malloc";
+            case Allocator::kMmap64k:
+                return "mmap64k";
+            case Allocator::kPool:
+                return "pool";
+        }
+        return "?";
+    }
+
+    // One measurement, taken in the child at the end of a phase. Plain data so it can be
+    // sent through a pipe.
+    struct Phase {
+        char name[16];
+        double payload_bytes;
+        double live_bytes;
+        double peak_live_bytes;
+        double allocations;
+        double rss_bytes;
+        double peak_rss_bytes;
+    };
+
+    // Collects the phases of one scenario. Each phase's peaks and allocation count start
+    // from where the previous phase ended.
+    class Recorder {
+    public:
+        static constexpr size_t kMaxPhases = 4;
+
+        Recorder()
+            : baseline_rss_(ResidentBytes())
+            , peak_rss_supported_(ResetPeakResident()) {
+            BeginPhase();
+        }
+
+        void EndPhase(const char* name, size_t payload_bytes) {
+            if (count_ == kMaxPhases) {
+                return;
+            }
+            Phase& phase = phases_[count_++];
+            std::snprintf(phase.name, sizeof(phase.name), "%s", name);
+            phase.payload_bytes = static_cast<double>(payload_bytes);
+            phase.live_bytes = static_cast<double>(g_live_bytes - baseline_live_);
+            phase.peak_live_bytes = static_cast<double>(g_peak_live_bytes - baseline_live_);
+            phase.allocations = static_cast<double>(g_allocations - allocations_);
+            phase.rss_bytes = static_cast<double>(ResidentBytes()) - static_cast<double>(baseline_rss_);
+            phase.peak_rss_bytes = peak_rss_supported_
+                                       ? static_cast<double>(PeakResidentBytes()) - static_cast<double>(baseline_rss_)
+                                       : NAN;
+            BeginPhase();
+        }
+
+        const Phase* Phases() const noexcept {
+            return phases_;
+        }
+
+        size_t Count() const noexcept {
+            return count_;
+        }
+
+    private:
+        void BeginPhase() {
+            g_peak_live_bytes = g_live_bytes;
+            allocations_ = g_allocations;
+            if (count_ == 0) {
+                baseline_live_ = g_live_bytes;
+            }
+            if (peak_rss_supported_) {
+                ResetPeakResident();
+            }
+        }
+
+    private:
+        Phase phases_[kMaxPhases] = {};
+        size_t count_ = 0;
+        size_t baseline_live_ = 0;
+        size_t allocations_ = 0;
+        size_t baseline_rss_ = 0;
+        bool peak_rss_supported_ = false;
+    };
+
+    struct Config {
+        // elements of the single large vector in the build scenarios
+        size_t elements = 8'000'000;
+        // vectors alive at once in the churn scenario
+        size_t churn_vectors = 20'000;
+        size_t churn_rounds = 8;
+    };
+
+    // Build scenarios: append config.elements uint64s under one growth policy ("built"),
+    // then drop to a quarter and shrink as far as the container allows ("shrunk")
+
+    void BuildDoubling(const Config& config, Recorder& recorder) {
+        Vector<uint64_t> vector;
+        for (size_t i = 0; i < config.elements; ++i) {
+            vector.EmplaceBack(i);
+        }
+        recorder.EndPhase("built", vector.Size() * sizeof(uint64_t));
+        vector.Resize(vector.Size() / 4);
+        vector.ShrinkToFit();
+        recorder.EndPhase("shrunk", vector.Size() * sizeof(uint64_t));
+    }
+
+    void BuildReserved(const Config& config, Recorder& recorder) {
+        Vector<uint64_t> vector;
+        vector.Reserve(config.elements);
+        for (size_t i = 0; i < config.elements; ++i) {
+            vector.EmplaceBack(i);
+        }
+        recorder.EndPhase("built", vector.Size() * sizeof(uint64_t));
+        vector.Resize(vector.Size() / 4);
+        vector.ShrinkToFit();
+        recorder.EndPhase("shrunk", vector.Size() * sizeof(uint64_t));
+    }
+
+    // "built" is the builder read in place through Chunk(); "finished" adds the copy into
+    // one contiguous Vector
+    void BuildChunked(const Config& config, Recorder& recorder) {
+        ChunkedBuilder<uint64_t> builder;
+        for (size_t i = 0; i < config.elements; ++i) {
+            builder.EmplaceBack(i);
+        }
+        recorder.EndPhase("built", builder.Size() * sizeof(uint64_t));
+        Vector<uint64_t> vector = builder.Finish();
+        recorder.EndPhase("finished", vector.Size() * sizeof(uint64_t));
+        vector.Resize(vector.Size() / 4);
+        vector.ShrinkToFit();
+        recorder.EndPhase("shrunk", vector.Size() * sizeof(uint64_t));
+    }
+
+    void BuildSegmented(const Config& config, Recorder& recorder) {
+        SegmentedVector<uint64_t> vector;
+        for (size_t i = 0; i < config.elements; ++i) {
+            vector.EmplaceBack(i);
+        }
+        recorder.EndPhase("built", vector.Size() * sizeof(uint64_t));
+        size_t keep = vector.Size() / 4;
+        while (vector.Size() > keep) {
+            vector.PopBack();
+        }
+        vector.ShrinkToFit();
+        recorder.EndPhase("shrunk", vector.Size() * sizeof(uint64_t));
+    }
+
+    // IncrementalVector has no ShrinkToFit; "shrunk" shows what it keeps after popping
+    void BuildIncremental(const Config& config, Recorder& recorder) {
+        IncrementalVector<uint64_t> vector;
+        for (size_t i = 0; i < config.elements; ++i) {
+            vector.EmplaceBack(i);
+        }
+        recorder.EndPhase("built", vector.Size() * sizeof(uint64_t));
+        size_t keep = vector.Size() / 4;
+        while (vector.Size() > keep) {
+            vector.PopBack();
+        }
+        recorder.EndPhase("shrunk", vector.Size() * sizeof(uint64_t));
+    }
+
+    // Churn: many vectors of log-uniform sizes are rebuilt over several rounds, then three
+    // quarters die ("churned"), leaving the survivors scattered across the heap. Finally the
+    // survivors are packed with a Compactor, which also trims the heap ("compacted").
+    void Churn(const Config& config, Allocator allocator, Recorder& recorder) {
+        VectorPool<uint64_t> pool;
+        auto release = [&](Vector<uint64_t>& vector) {
+            if (allocator == Allocator::kPool) {
+                pool.Recycle(std::move(vector));
+            } else {
+                vector = Vector<uint64_t>();
+            }
+        };
+        auto payload = [](const Vector<Vector<uint64_t>>& vectors) {
+            size_t bytes = 0;
+            for (const Vector<uint64_t>& vector : vectors) {
+                bytes += vector.Size() * sizeof(uint64_t);
+            }
+            return bytes;
+        };
+
+        std::mt19937_64 rng(42);
+        Vector<Vector<uint64_t>> vectors(config.churn_vectors);
+        for (size_t round = 0; round < config.churn_rounds; ++round) {
+            for (Vector<uint64_t>& vector : vectors) {
+                release(vector);
+                size_t size = size_t(1) << (rng() % 15);
+                size += rng() % size;
+                if (allocator == Allocator::kPool) {
+                    // without the size hint any recycled buffer would do, and capacities
+                    // would ratchet up to the largest size ever seen
+                    vector = pool.Acquire(size);
+                }
+                for (size_t i = 0; i < size; ++i) {
+                    vector.EmplaceBack(i);
+                }
+            }
+        }
+        for (Vector<uint64_t>& vector : vectors) {
+            if (rng() % 4 != 0) {
+                release(vector);
+            }
+        }
+        recorder.EndPhase("churned", payload(vectors));
+
+        pool.Trim();
+        Compactor compactor;
+        Vector<Compactor::Registration> registrations;
+        registrations.Reserve(vectors.Size());
+        for (Vector<uint64_t>& vector : vectors) {
+            registrations.PushBack(compactor.Register(vector));
+        }
+        compactor.Compact();
+        recorder.EndPhase("compacted", payload(vectors));
+    }
+
+    void Configure(Allocator allocator) {
+        if (allocator == Allocator::kMmap64k) {
+            mallopt(M_MMAP_THRESHOLD, 64 * 1024);
+            mallopt(M_TRIM_THRESHOLD, 128 * 1024);
+        }
+    }
+
+    // Runs scenario in a forked child and adds one row per phase it recorded
+    template <typename F>
+    void Run(const char* scenario, const char* policy, Allocator allocator, bench::Report& report, F&& run) {
+        int fds[2];
+        if (pipe(fds) != 0) {
+            std::perror("pipe");
+            return;
+        }
+        std::fflush(nullptr);
+        pid_t child = fork();
+        if (child < 0) {
+            std::perror("fork");
+            close(fds[0]);
+            close(fds[1]);
+            return;
+        }
+        if (child == 0) {
+            close(fds[0]);
+            Configure(allocator);
+            Recorder recorder;
+            run(recorder);
+            bool ok = write(fds[1], recorder.Phases(), recorder.Count() * sizeof(Phase)) ==
+                      static_cast<ssize_t>(recorder.Count() * sizeof(Phase));
+            _exit(ok ? 0 : 1);
+        }
+        close(fds[1]);
+        Phase phases[Recorder::kMaxPhases];
+        size_t received = 0;
+        ssize_t bytes;
+        while (received < sizeof(phases) &&
+               (bytes = read(fds[0], reinterpret_cast<char*>(phases) + received, sizeof(phases) - received)) > 0) {
+            received += static_cast<size_t>(bytes);
+        }
+        close(fds[0]);
+        int status = 0;
+        waitpid(child, &status, 0);
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+            std::fprintf(stderr, "%s/%s/%s: child failed\n", scenario, policy, AllocatorName(allocator));
+            return;
+        }
+        for (size_t i = 0; i < received / sizeof(Phase); ++i) {
+            const Phase& phase = phases[i];
+            report.Add(bench::Row()
+                           .Set("scenario", scenario)
+                           .Set("policy", policy)
+                           .Set("allocator", AllocatorName(allocator))
+                           .Set("phase", phase.name)
+                           .Set("payload_bytes", phase.payload_bytes)
+                           .Set("live_bytes", phase.live_bytes)
+                           .Set("peak_live_bytes", phase.peak_live_bytes)
+                           .Set("peak_over_payload", phase.payload_bytes != 0 ? phase.peak_live_bytes / phase.payload_bytes : NAN)
+                           .Set("allocations", phase.allocations)
+                           .Set("rss_bytes", phase.rss_bytes)
+                           .Set("peak_rss_bytes", phase.peak_rss_bytes)
+                           .Set("overhead_bytes", phase.rss_bytes - phase.live_bytes));
+        }
+    }
+}
+
+int main(int argc, char** argv) {
+    bench::Report::Format format = bench::Report::Format::kCsv;
+    double scale = 1.0;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--json") == 0) {
+            format = bench::Report::Format::kJson;
+        } else if (std::strcmp(argv[i], "--csv") == 0) {
+            format = bench::Report::Format::kCsv;
+        } else if (std::strcmp(argv[i], "--scale") == 0 && i + 1 < argc) {
+            scale = std::atof(argv[++i]);
+        } else {
+            std::fprintf(stderr, "usage: %s [--csv|--json] [--scale F]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    Config config;
+    config.elements = static_cast<size_t>(config.elements * scale);
+    config.churn_vectors = static_cast<size_t>(config.churn_vectors * scale);
+
+    bench::Report report(format);
+    report.SetMeta("scale", std::to_string(scale));
+    report.SetMeta("page_size", std::to_string(sysconf(_SC_PAGESIZE)));
+
+    for (Allocator allocator : {Allocator::kMalloc, Allocator::kMmap64k}) {
+        Run("build", "doubling", allocator, report, [&](Recorder& recorder) { BuildDoubling(config, recorder); });
+        Run("build", "reserved", allocator, report, [&](Recorder& recorder) { BuildReserved(config, recorder); });
+        Run("build", "chunked", allocator, report, [&](Recorder& recorder) { BuildChunked(config, recorder); });
+        Run("build", "segmented", allocator, report, [&](Recorder& recorder) { BuildSegmented(config, recorder); });
+        Run("build", "incremental", allocator, report, [&](Recorder& recorder) { BuildIncremental(config, recorder); });
+    }
+    for (Allocator allocator : {Allocator::kMalloc, Allocator::kMmap64k, Allocator::kPool}) {
+        Run("churn", "doubling", allocator, report, [&](Recorder& recorder) { Churn(config, allocator, recorder); });
+    }
+    report.Write();
+    return 0;
+}
@@ -0,0 +1,146 @@
+// Hardware performance counters for the container benchmarks via perf_event_open.
+// Each counter is opened on its own, so a PMU that lacks one event (or a container that
+// forbids perf entirely) just reports that column as unavailable instead of failing.
+#pragma once
+#include <cmath>
+#include <cstdint>
+#include <string>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "bench_support.h"
+
+namespace bench {
+    class PerfCounters {
+    public:
+        enum Counter {
+            kCycles,
+            kInstructions,
+            kL1dMisses,
+            kLlcMisses,
+            kDtlbMisses,
+            kBranchMisses,
+            kCounterCount,
+        };
+
+        // Counter values over one Start/Stop window; NaN where the counter is unavailable.
+        // Values are scaled up when the kernel had to multiplex counters.
+        struct Sample {
+            double values[kCounterCount];
+        };
+
+        static const char* Name(int counter) noexcept {
+            static const char* const names[kCounterCount] = {
+                "cycles", "instructions", "l1d_misses", "llc_misses", "dtlb_misses", "branch_misses",
+            };
+            return names[counter];
+        }
+
+        // Counts user-space events of the calling thread only
+        PerfCounters() noexcept {
+#if defined(__linux__)
+            fds_[kCycles] = Open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+            fds_[kInstructions] = Open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+            fds_[kL1dMisses] = Open(PERF_TYPE_HW_CACHE, CacheEvent(PERF_COUNT_HW_CACHE_L1D));
+            fds_[kLlcMisses] = Open(PERF_TYPE_HW_CACHE, CacheEvent(PERF_COUNT_HW_CACHE_LL));
+            fds_[kDtlbMisses] = Open(PERF_TYPE_HW_CACHE, CacheEvent(PERF_COUNT_HW_CACHE_DTLB));
+            fds_[kBranchMisses] = Open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES);
+#endif
+        }
+
+        PerfCounters(const PerfCounters&) = delete;
+        PerfCounters& operator=(const PerfCounters&) = delete;
+
+        ~PerfCounters() {
+#if defined(__linux__)
+            for (int fd : fds_) {
+                if (fd >= 0) {
+                    close(fd);
+                }
+            }
+#endif
+        }
+
+        bool Available(int counter) const noexcept {
+            return fds_[counter] >= 0;
+        }
+
+        // Whether any counter could be opened
+        bool AnyAvailable() const noexcept {
+            for (int fd : fds_) {
+                if (fd >= 0) {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        void Start() noexcept {
+#if defined(__linux__)
+            for (int fd : fds_) {
+                if (fd >= 0) {
+                    ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+                    ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+                }
+            }
+#endif
+        }
+
+        Sample Stop() noexcept {
+            Sample sample;
+            for (int counter = 0; counter < kCounterCount; ++counter) {
+                sample.values[counter] = NAN;
+            }
+#if defined(__linux__)
+            for (int fd : fds_) {
+                if (fd >= 0) {
+                    ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+                }
+            }
+            for (int counter = 0; counter < kCounterCount; ++counter) {
+                // value, time enabled, time running
+                uint64_t data[3];
+                if (fds_[counter] < 0 || read(fds_[counter], data, sizeof(data)) != sizeof(data) || data[2] == 0) {
+                    continue;
+                }
+                sample.values[counter] = static_cast<double>(data[0]) * static_cast<double>(data[1]) / static_cast<double>(data[2]);
+            }
+#endif
+            return sample;
+        }
+
+        // Adds one "<counter>_per_op" column per counter, empty where unavailable
+        static void AddColumns(Row& row, const Sample& sample, double operations) {
+            for (int counter = 0; counter < kCounterCount; ++counter) {
+                row.Set(std::string(Name(counter)) + "_per_op", sample.values[counter] / operations);
+            }
+        }
+
+    private:
+#if defined(__linux__)
+        static uint64_t CacheEvent(uint64_t cache) noexcept {
+            return cache | (uint64_t(PERF_COUNT_HW_CACHE_OP_READ) << 8) | (uint64_t(PERF_COUNT_HW_CACHE_RESULT_MISS) << 16);
+        }
+
+        static int Open(uint32_t type, uint64_t config) noexcept {
+            perf_event_attr attr{};
+            attr.size = sizeof(attr);
+            attr.type = type;
+            attr.config = config;
+            attr.disabled = 1;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+            long fd = syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+            return fd >= 0 ? static_cast<int>(fd) : -1;
+        }
+#endif
+
+        int fds_[kCounterCount] = {-1, -1, -1, -1, -1, -1};
+    };
+}//namespace bench
@@ -0,0 +1,71 @@
+// Fused expression templates versus the naive temporary-allocating approach.
+// Build: g++ -std=c++17 -O3 -march=native -I.. vector_expr_bench.cpp -o vector_expr_bench
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+#include "../vector_expr.h"
+
+namespace {
+    using notstd::Vector;
+
+    Vector<double> NaiveAdd(const Vector<double>& lhs, const Vector<double>& rhs) {
+        Vector<double> result(lhs.Size());
+        for (size_t i = 0; i < lhs.Size(); ++i) {
+            result[i] = lhs[i] + rhs[i];
+        }
+        return result;
+    }
+
+    Vector<double> NaiveScale(const Vector<double>& lhs, double factor) {
+        Vector<double> result(lhs.Size());
+        for (size_t i = 0; i < lhs.Size(); ++i) {
+            result[i] = lhs[i] * factor;
+        }
+        return result;
+    }
+
+    template <typename F>
+    double BestOfMs(int repeats, F&& f) {
+        double best = 1e300;
+        for (int r = 0; r < repeats; ++r) {
+            auto start = std::chrono::steady_clock::now();
+            f();
+            std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+            best = elapsed.count() < best ? elapsed.count() : best;
+        }
+        return best;
+    }
+}
+
+int main(int argc, char** argv) {
+    const size_t size = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 10'000'000;
+    const int repeats = argc > 2 ? std::atoi(argv[2]) : 10;
+
+    Vector<double> a(size), b(size), c(size), d(size);
+    for (size_t i = 0; i < size; ++i) {
+        a[i] = static_cast<double>(i % 1000);
+        b[i] = static_cast<double>(i % 7);
+        c[i] = static_cast<double>(i % 13);
+    }
+
+    Vector<double> naive;
+    double naive_ms = BestOfMs(repeats, [&] {
+        naive = NaiveAdd(NaiveAdd(NaiveScale(a, 2.0), b), NaiveScale(c, 0.5));
+    });
+
+    double fused_ms = BestOfMs(repeats, [&] {
+        d = a * 2.0 + b + c * 0.5;
+    });
+
+    for (size_t i = 0; i < size; ++i) {
+        if (naive[i] != d[i]) {
+            std::fprintf(stderr, "mismatch at %zu\n", i);
+            return 1;
+        }
+    }
+
+    std::printf("elements=%zu naive=%.3fms fused=%.3fms speedup=%.2fx\n",
+                size, naive_ms, fused_ms, naive_ms / fused_ms);
+    return 0;
+}
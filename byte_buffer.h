@@ -0,0 +1,242 @@
+#pragma once
+#include <cassert>
+#include <cstddef>
+#include <cstring>
+#include <type_traits>
+#include <utility>
+
+#include "vector.h"
+
+namespace notstd {
+    // Byte buffer for building and parsing messages. The bytes live at
+    //     [headroom | readable: Readable() | spare: SpareCapacity()]
+    // so a header can be prepended in front of an already-written payload without moving
+    // it, and consumed bytes are skipped rather than shifted out. Small messages stay in
+    // inline storage; larger ones move to the heap, and that allocation is kept by Clear()
+    // so one buffer can serve message after message without reallocating.
+    class ByteBuffer {
+    public:
+        static constexpr size_t kInlineCapacity = 128;
+        static constexpr size_t kDefaultHeadroom = 16;
+
+        explicit ByteBuffer(size_t headroom = kDefaultHeadroom)
+            : headroom_(headroom)
+            , read_(headroom)
+            , write_(headroom) {
+            if (headroom_ > kInlineCapacity) {
+                RawMemory<std::byte>(headroom_ * 2).Swap(heap_);
+            }
+        }
+
+        ByteBuffer(const ByteBuffer& other)
+            : ByteBuffer(other.headroom_) {
+            Append(other.Readable());
+        }
+
+        ByteBuffer(ByteBuffer&& other) noexcept
+            : heap_(std::move(other.heap_))
+            , headroom_(other.headroom_)
+            , read_(other.read_)
+            , write_(other.write_) {
+            if (heap_.Capacity() == 0) {
+                std::memcpy(inline_ + read_, other.inline_ + read_, write_ - read_);
+            }
+            other.read_ = other.write_ = other.headroom_ <= kInlineCapacity ? other.headroom_ : 0;
+        }
+
+        // Keeps this buffer's own headroom and allocation
+        ByteBuffer& operator=(const ByteBuffer& rhs) {
+            if (this != &rhs) {
+                Clear();
+                Append(rhs.Readable());
+            }
+            return *this;
+        }
+
+        ByteBuffer& operator=(ByteBuffer&& rhs) noexcept {
+            if (this != &rhs) {
+                heap_ = std::move(rhs.heap_);
+                headroom_ = rhs.headroom_;
+                read_ = rhs.read_;
+                write_ = rhs.write_;
+                if (heap_.Capacity() == 0) {
+                    std::memcpy(inline_ + read_, rhs.inline_ + read_, write_ - read_);
+                }
+                rhs.read_ = rhs.write_ = rhs.headroom_ <= kInlineCapacity ? rhs.headroom_ : 0;
+            }
+            return *this;
+        }
+
+        size_t Size() const noexcept {
+            return write_ - read_;
+        }
+
+        bool Empty() const noexcept {
+            return read_ == write_;
+        }
+
+        size_t Capacity() const noexcept {
+            return heap_.Capacity() != 0 ? heap_.Capacity() : kInlineCapacity;
+        }
+
+        // Bytes that Prepend can fill without moving the readable bytes
+        size_t Headroom() const noexcept {
+            return read_;
+        }
+
+        bool IsInline() const noexcept {
+            return heap_.Capacity() == 0;
+        }
+
+        Span<const std::byte> Readable() const noexcept {
+            return Span<const std::byte>(Base() + read_, Size());
+        }
+
+        Span<std::byte> Readable() noexcept {
+            return Span<std::byte>(Base() + read_, Size());
+        }
+
+        // Zero-copy view of part of the readable bytes, valid until the buffer is modified
+        Span<const std::byte> Slice(size_t offset, size_t count = dynamic_extent) const noexcept {
+            return Readable().Subspan(offset, count);
+        }
+
+        // Writable space after the readable bytes, at least min_bytes long. Bytes written
+        // there become readable after CommitAppend.
+        Span<std::byte> SpareCapacity(size_t min_bytes = 1) {
+            if (Capacity() - write_ < min_bytes) {
+                MakeRoom(headroom_, min_bytes);
+            }
+            return Span<std::byte>(Base() + write_, Capacity() - write_);
+        }
+
+        void CommitAppend(size_t count) noexcept {
+            assert(count <= Capacity() - write_);
+            write_ += count;
+        }
+
+        void Append(Span<const std::byte> bytes) {
+            if (bytes.Empty()) {
+                return;
+            }
+            std::memcpy(SpareCapacity(bytes.Size()).Data(), bytes.Data(), bytes.Size());
+            write_ += bytes.Size();
+        }
+
+        // Puts bytes in front of the readable ones, using headroom when there is enough
+        void Prepend(Span<const std::byte> bytes) {
+            if (read_ < bytes.Size()) {
+                MakeRoom(headroom_ + bytes.Size(), 0);
+            }
+            read_ -= bytes.Size();
+            if (!bytes.Empty()) {
+                std::memcpy(Base() + read_, bytes.Data(), bytes.Size());
+            }
+        }
+
+        template <typename T>
+        void AppendValue(const T& value) {
+            static_assert(std::is_trivially_copyable_v<T>, "only trivially copyable values can be written as bytes");
+            Append(AsBytes(Span<const T>(&value, 1)));
+        }
+
+        template <typename T>
+        void PrependValue(const T& value) {
+            static_assert(std::is_trivially_copyable_v<T>, "only trivially copyable values can be written as bytes");
+            Prepend(AsBytes(Span<const T>(&value, 1)));
+        }
+
+        // Drops count bytes from the front of the readable bytes
+        void Consume(size_t count) noexcept {
+            assert(count <= Size());
+            read_ += count;
+            if (read_ == write_) {
+                Clear();
+            }
+        }
+
+        // Copies up to out.Size() readable bytes into out and consumes them
+        size_t Read(Span<std::byte> out) noexcept {
+            size_t count = out.Size() < Size() ? out.Size() : Size();
+            if (count != 0) {
+                std::memcpy(out.Data(), Base() + read_, count);
+            }
+            Consume(count);
+            return count;
+        }
+
+        // Forgets the contents but keeps the allocation and the configured headroom
+        void Clear() noexcept {
+            read_ = write_ = headroom_ <= Capacity() ? headroom_ : 0;
+        }
+
+        // Ensures Append can add min_bytes without reallocating
+        void Reserve(size_t min_bytes) {
+            if (Capacity() - write_ < min_bytes) {
+                MakeRoom(headroom_, min_bytes);
+            }
+        }
+
+        // Returns a heap buffer to the allocator, falling back to inline storage if it fits
+        void ShrinkToFit() {
+            if (IsInline() || Capacity() == headroom_ + Size()) {
+                return;
+            }
+            Rebuild(headroom_, headroom_ + Size() <= kInlineCapacity ? 0 : headroom_ + Size());
+        }
+
+        Vector<std::byte> ToVector() const {
+            Vector<std::byte> result;
+            result.Reserve(Size());
+            if (!Empty()) {
+                std::memcpy(result.SpareCapacity().Data(), Base() + read_, Size());
+            }
+            result.CommitAppend(Size());
+            return result;
+        }
+
+    private:
+        const std::byte* Base() const noexcept {
+            return heap_.Capacity() != 0 ? heap_.GetAddress() : inline_;
+        }
+
+        std::byte* Base() noexcept {
+            return heap_.Capacity() != 0 ? heap_.GetAddress() : inline_;
+        }
+
+        // Arranges for at least `front` bytes before and `back` bytes after the readable
+        // ones: slides the bytes back over consumed space when that suffices, otherwise
+        // grows geometrically
+        void MakeRoom(size_t front, size_t back) {
+            size_t needed = front + Size() + back;
+            if (needed <= Capacity()) {
+                std::memmove(Base() + front, Base() + read_, Size());
+                write_ = front + Size();
+                read_ = front;
+                return;
+            }
+            size_t capacity = Capacity() * 2;
+            Rebuild(front, capacity < needed ? needed : capacity);
+        }
+
+        // Moves the readable bytes to offset front of a new heap buffer of capacity bytes,
+        // or to inline storage when capacity is 0
+        void Rebuild(size_t front, size_t capacity) {
+            RawMemory<std::byte> fresh = heap_.Replacement(capacity);
+            std::byte* target = capacity != 0 ? fresh.GetAddress() : inline_;
+            if (!Empty()) {
+                std::memmove(target + front, Base() + read_, Size());
+            }
+            write_ = front + Size();
+            read_ = front;
+            heap_.Swap(fresh);
+        }
+
+    private:
+        RawMemory<std::byte> heap_;
+        size_t headroom_;
+        size_t read_;
+        size_t write_;
+        std::byte inline_[kInlineCapacity];
+    };
+}//namespace notstd
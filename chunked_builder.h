@@ -0,0 +1,150 @@
+#pragma once
+#include <cassert>
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+#include "vector.h"
+
+namespace notstd {
+    // Accumulates an unknown number of elements in fixed-size chunks, so growing never
+    // copies what is already stored. Peak memory while building is the data plus one
+    // partially filled chunk, and reading it in place through Chunk() keeps it there; that is
+    // the way to consume the data when memory is the binding limit. Finish() produces one
+    // contiguous Vector instead, at a peak of 2x the data (against 3x for the last doubling
+    // of a Vector).
+    template <typename T>
+    class ChunkedBuilder {
+    public:
+        static constexpr size_t kDefaultChunkBytes = 64 * 1024;
+
+        explicit ChunkedBuilder(size_t chunk_size = kDefaultChunkBytes / sizeof(T) != 0 ? kDefaultChunkBytes / sizeof(T) : 1)
+            : chunk_size_(chunk_size) {
+            assert(chunk_size_ != 0);
+        }
+
+        ChunkedBuilder(const ChunkedBuilder&) = delete;
+        ChunkedBuilder& operator=(const ChunkedBuilder&) = delete;
+
+        ChunkedBuilder(ChunkedBuilder&& other) noexcept
+            : chunks_(std::move(other.chunks_))
+            , chunk_size_(other.chunk_size_)
+            , size_(other.size_) {
+            other.size_ = 0;
+        }
+
+        ChunkedBuilder& operator=(ChunkedBuilder&& rhs) noexcept {
+            if (this != &rhs) {
+                Clear();
+                chunks_ = std::move(rhs.chunks_);
+                chunk_size_ = rhs.chunk_size_;
+                size_ = rhs.size_;
+                rhs.size_ = 0;
+            }
+            return *this;
+        }
+
+        ~ChunkedBuilder() {
+            Clear();
+        }
+
+        template <typename... Args>
+        T& EmplaceBack(Args&&... args) {
+            size_t chunk = size_ / chunk_size_;
+            if (chunk == chunks_.Size()) {
+                chunks_.EmplaceBack(chunk_size_);
+            }
+            T* slot = chunks_[chunk] + (size_ % chunk_size_);
+            detail::ConstructAt(slot, std::forward<Args>(args)...);
+            ++size_;
+            return *slot;
+        }
+
+        template <typename V>
+        void PushBack(V&& value) {
+            EmplaceBack(std::forward<V>(value));
+        }
+
+        // Appends a run of trivially copyable elements, filling chunk by chunk
+        void Append(Span<const T> values) {
+            static_assert(std::is_trivially_copyable_v<T>, "use EmplaceBack for non-trivial elements");
+            while (!values.Empty()) {
+                size_t chunk = size_ / chunk_size_;
+                if (chunk == chunks_.Size()) {
+                    chunks_.EmplaceBack(chunk_size_);
+                }
+                size_t offset = size_ % chunk_size_;
+                size_t count = chunk_size_ - offset < values.Size() ? chunk_size_ - offset : values.Size();
+                std::memcpy(chunks_[chunk] + offset, values.Data(), count * sizeof(T));
+                size_ += count;
+                values = values.Subspan(count);
+            }
+        }
+
+        size_t Size() const noexcept {
+            return size_;
+        }
+
+        size_t ChunkCount() const noexcept {
+            return (size_ + chunk_size_ - 1) / chunk_size_;
+        }
+
+        Span<T> Chunk(size_t chunk) noexcept {
+            assert(chunk < ChunkCount());
+            return Span<T>(chunks_[chunk].GetAddress(), ChunkSize(chunk));
+        }
+
+        Span<const T> Chunk(size_t chunk) const noexcept {
+            assert(chunk < ChunkCount());
+            return Span<const T>(chunks_[chunk].GetAddress(), ChunkSize(chunk));
+        }
+
+        // Moves the elements into a Vector allocated once at the exact size. The result is
+        // allocated while every chunk is still alive, so the peak is 2x the data; chunks are
+        // freed as they drain, which brings it back to 1x by the end. Prefer Chunk() where
+        // the data need not be contiguous. The builder is left empty.
+        Vector<T> Finish() {
+            static_assert(std::is_nothrow_move_constructible_v<T>, "Finish relocates elements and must not throw midway");
+            Vector<T> result;
+            result.Reserve(size_);
+            for (size_t chunk = 0; chunk < ChunkCount(); ++chunk) {
+                Span<T> items = Chunk(chunk);
+                if constexpr (std::is_trivially_copyable_v<T>) {
+                    std::memcpy(result.SpareCapacity().Data(), items.Data(), items.SizeBytes());
+                    result.CommitAppend(items.Size());
+                } else {
+                    for (T& item : items) {
+                        result.EmplaceBack(std::move(item));
+                    }
+                    std::destroy_n(items.Data(), items.Size());
+                }
+                RawMemory<T>().Swap(chunks_[chunk]);
+            }
+            chunks_ = Vector<RawMemory<T>>();
+            size_ = 0;
+            return result;
+        }
+
+        // Destroys the elements and frees all chunks
+        void Clear() noexcept {
+            for (size_t chunk = 0; chunk < ChunkCount(); ++chunk) {
+                std::destroy_n(chunks_[chunk].GetAddress(), ChunkSize(chunk));
+            }
+            chunks_ = Vector<RawMemory<T>>();
+            size_ = 0;
+        }
+
+    private:
+        size_t ChunkSize(size_t chunk) const noexcept {
+            size_t start = chunk * chunk_size_;
+            return size_ - start < chunk_size_ ? size_ - start : chunk_size_;
+        }
+
+    private:
+        Vector<RawMemory<T>> chunks_;
+        size_t chunk_size_;
+        size_t size_ = 0;
+    };
+}//namespace notstd
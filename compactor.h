@@ -0,0 +1,152 @@
+#pragma once
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <utility>
+
+#if defined(__GLIBC__)
+#include <malloc.h>
+#endif
+
+#include "vector.h"
+
+namespace notstd {
+    struct CompactionStats {
+        size_t relocated = 0;
+        // capacity of the relocated vectors before and after, in bytes
+        size_t bytes_before = 0;
+        size_t bytes_after = 0;
+    };
+
+    // Defragments the heap behind a set of long-lived vectors. Compact() moves each
+    // registered vector into a fresh exact-size allocation, one at a time so the freed
+    // buffers are reused by the next ones, then asks the allocator to return free pages to
+    // the OS. It must run while no other thread touches the registered vectors, e.g. during
+    // an idle period. Pointers and iterators into a relocated vector are invalidated; its
+    // callback runs right after the move so owners can re-fetch them.
+    class Compactor {
+    public:
+        // Unregisters the vector when destroyed; must not outlive the vector or the Compactor
+        class Registration {
+        public:
+            Registration() noexcept = default;
+
+            Registration(Registration&& other) noexcept
+                : owner_(std::exchange(other.owner_, nullptr))
+                , id_(other.id_) {
+            }
+
+            Registration& operator=(Registration&& rhs) noexcept {
+                if (this != &rhs) {
+                    Reset();
+                    owner_ = std::exchange(rhs.owner_, nullptr);
+                    id_ = rhs.id_;
+                }
+                return *this;
+            }
+
+            ~Registration() {
+                Reset();
+            }
+
+            void Reset() noexcept {
+                if (owner_ != nullptr) {
+                    std::exchange(owner_, nullptr)->Unregister(id_);
+                }
+            }
+
+        private:
+            friend class Compactor;
+
+            Registration(Compactor* owner, size_t id) noexcept
+                : owner_(owner)
+                , id_(id) {
+            }
+
+            Compactor* owner_ = nullptr;
+            size_t id_ = 0;
+        };
+
+        Compactor() = default;
+        Compactor(const Compactor&) = delete;
+        Compactor& operator=(const Compactor&) = delete;
+
+        // on_relocated must not register or unregister vectors
+        template <typename T>
+        [[nodiscard]] Registration Register(Vector<T>& vector, std::function<void()> on_relocated = {}) {
+            std::lock_guard lock(mutex_);
+            size_t id = next_id_++;
+            entries_.PushBack(Entry{id, &vector, &RelocateVector<T>, std::move(on_relocated)});
+            return Registration(this, id);
+        }
+
+        size_t Registered() const {
+            std::lock_guard lock(mutex_);
+            return entries_.Size();
+        }
+
+        // Relocates every registered vector that owns a buffer. If an allocation fails the
+        // exception propagates; vectors already relocated stay relocated.
+        CompactionStats Compact(bool release_to_os = true) {
+            std::lock_guard lock(mutex_);
+            CompactionStats stats;
+            for (Entry& entry : entries_) {
+                auto [before, after] = entry.relocate(entry.vector);
+                if (before == 0) {
+                    continue;
+                }
+                ++stats.relocated;
+                stats.bytes_before += before;
+                stats.bytes_after += after;
+                if (entry.on_relocated) {
+                    entry.on_relocated();
+                }
+            }
+#if defined(__GLIBC__)
+            if (release_to_os) {
+                malloc_trim(0);
+            }
+#else
+            (void)release_to_os;
+#endif
+            return stats;
+        }
+
+    private:
+        struct Entry {
+            size_t id;
+            void* vector;
+            // returns the capacity in bytes before and after
+            std::pair<size_t, size_t> (*relocate)(void* vector);
+            std::function<void()> on_relocated;
+        };
+
+        template <typename T>
+        static std::pair<size_t, size_t> RelocateVector(void* erased) {
+            Vector<T>& vector = *static_cast<Vector<T>*>(erased);
+            size_t before = vector.Capacity() * sizeof(T);
+            if (before != 0) {
+                vector.Relocate();
+            }
+            return {before, vector.Capacity() * sizeof(T)};
+        }
+
+        void Unregister(size_t id) noexcept {
+            std::lock_guard lock(mutex_);
+            for (size_t i = 0; i < entries_.Size(); ++i) {
+                if (entries_[i].id == id) {
+                    if (i + 1 != entries_.Size()) {
+                        entries_[i] = std::move(entries_[entries_.Size() - 1]);
+                    }
+                    entries_.PopBack();
+                    return;
+                }
+            }
+        }
+
+    private:
+        mutable std::mutex mutex_;
+        Vector<Entry> entries_;
+        size_t next_id_ = 0;
+    };
+}//namespace notstd
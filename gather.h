@@ -0,0 +1,283 @@
+#pragma once
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <type_traits>
+
+#if defined(__AVX2__) || defined(__AVX512F__)
+#include <immintrin.h>
+#endif
+
+#include "vector.h"
+
+namespace notstd {
+    // How many elements ahead indirect accesses are prefetched by default. At ~100ns DRAM
+    // latency and a few ns per element this keeps enough misses in flight to cover it.
+    inline constexpr size_t kDefaultPrefetchDistance = 16;
+
+    inline void PrefetchForRead(const void* address) noexcept {
+#if defined(__GNUC__) || defined(__clang__)
+        __builtin_prefetch(address, 0, 3);
+#else
+        (void)address;
+#endif
+    }
+
+    inline void PrefetchForWrite(const void* address) noexcept {
+#if defined(__GNUC__) || defined(__clang__)
+        __builtin_prefetch(address, 1, 3);
+#else
+        (void)address;
+#endif
+    }
+
+    namespace gather_detail {
+        // std::type_identity_t is C++20; keeps a parameter out of template argument deduction
+        template <typename T>
+        struct TypeIdentity {
+            using type = T;
+        };
+
+        template <typename T>
+        using NonDeduced = typename TypeIdentity<T>::type;
+
+        template <typename T, typename I>
+        void GatherScalar(const T* src, const I* indices, T* out, size_t begin, size_t end,
+                          size_t count, size_t distance) noexcept {
+            for (size_t i = begin; i < end; ++i) {
+                if (i + distance < count) {
+                    PrefetchForRead(src + indices[i + distance]);
+                }
+                out[i] = src[indices[i]];
+            }
+        }
+
+        // Hardware gathers load raw lanes, so any arithmetic type of the lane width can use them,
+        // as can 64-bit elements addressed by 32-bit indices. Other pairings (e.g. 64-bit indices
+        // into 32-bit elements) stay scalar. The index lanes are read as signed, so when unsigned
+        // indices into a source larger than the signed lane range have the top bit set, that
+        // block is gathered by GatherScalar.
+        template <typename T, typename I>
+        size_t GatherSimd(const T* src, size_t src_size, const I* indices, T* out, size_t count,
+                          size_t distance) noexcept {
+            constexpr bool kSameWidth = sizeof(T) == sizeof(I) && (sizeof(T) == 4 || sizeof(T) == 8);
+            // the index vector is half as wide as the data vector
+            constexpr bool kNarrowIndex = sizeof(T) == 8 && sizeof(I) == 4;
+            if constexpr (!std::is_arithmetic_v<T> || !std::is_integral_v<I> || !(kSameWidth || kNarrowIndex)) {
+                return 0;
+            } else {
+#if defined(__AVX512F__) || defined(__AVX2__)
+#if defined(__AVX512F__)
+                constexpr size_t kLanes = 64 / sizeof(T);
+#else
+                constexpr size_t kLanes = 32 / sizeof(T);
+#endif
+                {
+                    const bool check_sign = std::is_unsigned_v<I>
+                                            && src_size > static_cast<size_t>(std::numeric_limits<std::make_signed_t<I>>::max());
+                    size_t i = 0;
+                    for (; i + kLanes <= count; i += kLanes) {
+                        for (size_t p = i + distance; p < i + distance + kLanes && p < count; ++p) {
+                            PrefetchForRead(src + indices[p]);
+                        }
+#if defined(__AVX512F__)
+                        if constexpr (kNarrowIndex) {
+                            __m256i idx = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(indices + i));
+                            if (check_sign && _mm256_movemask_epi8(idx) & 0x88888888) {
+                                GatherScalar(src, indices, out, i, i + kLanes, count, 0);
+                                continue;
+                            }
+                            _mm512_storeu_si512(out + i, _mm512_i32gather_epi64(idx, src, 8));
+                            continue;
+                        }
+                        __m512i idx = _mm512_loadu_si512(indices + i);
+                        if (check_sign) {
+                            bool negative = sizeof(T) == 8 ? _mm512_cmplt_epi64_mask(idx, _mm512_setzero_si512()) != 0
+                                                           : _mm512_cmplt_epi32_mask(idx, _mm512_setzero_si512()) != 0;
+                            if (negative) {
+                                GatherScalar(src, indices, out, i, i + kLanes, count, 0);
+                                continue;
+                            }
+                        }
+                        if constexpr (sizeof(T) == 8) {
+                            _mm512_storeu_si512(out + i, _mm512_i64gather_epi64(idx, src, 8));
+                        } else {
+                            _mm512_storeu_si512(out + i, _mm512_i32gather_epi32(idx, src, 4));
+                        }
+#else
+                        __m256i lanes;
+                        if constexpr (kNarrowIndex) {
+                            __m128i idx = _mm_loadu_si128(reinterpret_cast<const __m128i*>(indices + i));
+                            if (check_sign && _mm_movemask_epi8(idx) & 0x8888) {
+                                GatherScalar(src, indices, out, i, i + kLanes, count, 0);
+                                continue;
+                            }
+                            lanes = _mm256_i32gather_epi64(reinterpret_cast<const long long*>(src), idx, 8);
+                        } else {
+                            __m256i idx = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(indices + i));
+                            // the sign bit of every lane, whatever its width
+                            if (check_sign && _mm256_movemask_epi8(idx) & (sizeof(T) == 8 ? 0x80808080 : 0x88888888)) {
+                                GatherScalar(src, indices, out, i, i + kLanes, count, 0);
+                                continue;
+                            }
+                            if constexpr (sizeof(T) == 8) {
+                                lanes = _mm256_i64gather_epi64(reinterpret_cast<const long long*>(src), idx, 8);
+                            } else {
+                                lanes = _mm256_i32gather_epi32(reinterpret_cast<const int*>(src), idx, 4);
+                            }
+                        }
+                        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), lanes);
+#endif
+                    }
+                    return i;
+                }
+#else
+                (void)src, (void)src_size, (void)indices, (void)out, (void)count, (void)distance;
+                return 0;
+#endif
+            }
+        }
+    }//namespace gather_detail
+
+    // out[i] = src[indices[i]], prefetching `distance` indices ahead. T is deduced from out
+    // alone, so src may be passed as a Span<T> or Span<const T>; indices may be either too.
+    // With AVX2/AVX-512, 4- and 8-byte elements use hardware gathers when the indices are the
+    // same width or, for 8-byte elements, 32-bit; any other pairing runs the scalar loop.
+    template <typename T, typename I>
+    void Gather(gather_detail::NonDeduced<Span<const T>> src, Span<I> indices, Span<T> out,
+                size_t distance = kDefaultPrefetchDistance) noexcept {
+        using Index = std::remove_const_t<I>;
+        static_assert(std::is_integral_v<Index>, "indices must be integral");
+        assert(out.Size() >= indices.Size());
+        const Index* index = indices.Data();
+        size_t done = gather_detail::GatherSimd(src.Data(), src.Size(), index, out.Data(), indices.Size(), distance);
+        gather_detail::GatherScalar(src.Data(), index, out.Data(), done, indices.Size(), indices.Size(), distance);
+    }
+
+    // dst[indices[i]] = values[i], prefetching `distance` destinations ahead.
+    // With duplicate indices the last value wins. T is deduced from dst alone.
+    template <typename T, typename I>
+    void Scatter(gather_detail::NonDeduced<Span<const T>> values, Span<I> indices, Span<T> dst,
+                 size_t distance = kDefaultPrefetchDistance) noexcept {
+        static_assert(std::is_integral_v<std::remove_const_t<I>>, "indices must be integral");
+        assert(values.Size() >= indices.Size());
+        const size_t count = indices.Size();
+        for (size_t i = 0; i < count; ++i) {
+            if (i + distance < count) {
+                PrefetchForWrite(dst.Data() + indices[i + distance]);
+            }
+            assert(static_cast<size_t>(indices[i]) < dst.Size());
+            dst[indices[i]] = values[i];
+        }
+    }
+
+    template <typename T, typename I>
+    void Gather(const Vector<T>& src, const Vector<I>& indices, Vector<T>& out,
+                size_t distance = kDefaultPrefetchDistance) {
+        out.Resize(indices.Size());
+        Gather(src.AsSpan(), indices.AsSpan(), out.AsSpan(), distance);
+    }
+
+    template <typename T, typename I>
+    void Scatter(const Vector<T>& values, const Vector<I>& indices, Vector<T>& dst,
+                 size_t distance = kDefaultPrefetchDistance) {
+        Scatter(values.AsSpan(), indices.AsSpan(), dst.AsSpan(), distance);
+    }
+
+    // Iterates src[indices[0]], src[indices[1]], ... issuing a prefetch for the element
+    // `distance` positions ahead on every step.
+    template <typename T, typename I>
+    class IndexedRange {
+    public:
+        class Iterator {
+        public:
+            using iterator_category = std::forward_iterator_tag;
+            using value_type = std::remove_cv_t<T>;
+            using difference_type = std::ptrdiff_t;
+            using pointer = T*;
+            using reference = T&;
+
+            Iterator(T* src, const I* index, const I* prefetch, const I* last) noexcept
+                : src_(src)
+                , index_(index)
+                , prefetch_(prefetch)
+                , last_(last) {
+            }
+
+            T& operator*() const noexcept {
+                return src_[*index_];
+            }
+
+            T* operator->() const noexcept {
+                return src_ + *index_;
+            }
+
+            Iterator& operator++() noexcept {
+                ++index_;
+                if (prefetch_ < last_) {
+                    PrefetchForRead(src_ + *prefetch_);
+                    ++prefetch_;
+                }
+                return *this;
+            }
+
+            Iterator operator++(int) noexcept {
+                Iterator tmp = *this;
+                ++*this;
+                return tmp;
+            }
+
+            friend bool operator==(const Iterator& lhs, const Iterator& rhs) noexcept {
+                return lhs.index_ == rhs.index_;
+            }
+
+            friend bool operator!=(const Iterator& lhs, const Iterator& rhs) noexcept {
+                return lhs.index_ != rhs.index_;
+            }
+
+        private:
+            T* src_;
+            const I* index_;
+            const I* prefetch_;
+            const I* last_;
+        };
+
+        IndexedRange(Span<T> src, Span<const I> indices, size_t distance = kDefaultPrefetchDistance) noexcept
+            : src_(src)
+            , indices_(indices)
+            , distance_(distance < indices.Size() ? distance : indices.Size()) {
+        }
+
+        Iterator begin() const noexcept {
+            const I* first = indices_.Data();
+            const I* last = first + indices_.Size();
+            // warm up the first window so the loop body only ever prefetches one element
+            for (const I* p = first; p < first + distance_; ++p) {
+                PrefetchForRead(src_.Data() + *p);
+            }
+            return Iterator(src_.Data(), first, first + distance_, last);
+        }
+
+        Iterator end() const noexcept {
+            const I* last = indices_.Data() + indices_.Size();
+            return Iterator(src_.Data(), last, last, last);
+        }
+
+    private:
+        Span<T> src_;
+        Span<const I> indices_;
+        size_t distance_;
+    };
+
+    template <typename T, typename I>
+    IndexedRange<T, I> Indexed(Vector<T>& src, const Vector<I>& indices, size_t distance = kDefaultPrefetchDistance) noexcept {
+        return IndexedRange<T, I>(src.AsSpan(), indices.AsSpan(), distance);
+    }
+
+    template <typename T, typename I>
+    IndexedRange<const T, I> Indexed(const Vector<T>& src, const Vector<I>& indices, size_t distance = kDefaultPrefetchDistance) noexcept {
+        return IndexedRange<const T, I>(src.AsSpan(), indices.AsSpan(), distance);
+    }
+}//namespace notstd
@@ -0,0 +1,215 @@
+#pragma once
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <iterator>
+#include <type_traits>
+
+// Opt-in debug mode: build with -DNOTSTD_HARDENED=1 to get checked Vector iterators and
+// bounds-checked indexing that stay active under NDEBUG. With the default of 0 iterators
+// are raw pointers and none of the checks below are compiled in.
+#ifndef NOTSTD_HARDENED
+#define NOTSTD_HARDENED 0
+#endif
+
+// Under AddressSanitizer, Vector marks [Size(), Capacity()) as poisoned so reads of the
+// uninitialized tail are reported. Define NOTSTD_NO_CONTAINER_ANNOTATIONS to turn this off
+// when linking with uninstrumented code that touches Vector storage.
+#if defined(__SANITIZE_ADDRESS__)
+#define NOTSTD_HAS_ASAN 1
+#elif defined(__has_feature)
+#if __has_feature(address_sanitizer)
+#define NOTSTD_HAS_ASAN 1
+#endif
+#endif
+
+// GCC ships no <sanitizer/allocator_interface.h>, but its runtime exports the same calls
+#if defined(NOTSTD_HAS_ASAN)
+extern "C" int __sanitizer_get_ownership(const volatile void* p);
+extern "C" size_t __sanitizer_get_allocated_size(const volatile void* p);
+#endif
+
+#if defined(NOTSTD_HAS_ASAN) && !defined(NOTSTD_NO_CONTAINER_ANNOTATIONS)
+#define NOTSTD_ANNOTATE_CONTAINERS 1
+#include <sanitizer/common_interface_defs.h>
+#else
+#define NOTSTD_ANNOTATE_CONTAINERS 0
+#endif
+
+namespace notstd {
+    namespace detail {
+        [[noreturn]] inline void HardeningFailure(const char* message) noexcept {
+            std::fprintf(stderr, "notstd hardening check failed: %s\n", message);
+            std::abort();
+        }
+
+        // Random access iterator that remembers which container and which allocation it was
+        // taken from. Owner exposes Data(), Size() and Generation(); the generation changes
+        // whenever the owner's storage is swapped out, so a stale iterator is caught on use.
+        template <typename T, typename Owner>
+        class CheckedIterator {
+        public:
+            using iterator_category = std::random_access_iterator_tag;
+            using value_type = std::remove_cv_t<T>;
+            using difference_type = std::ptrdiff_t;
+            using pointer = T*;
+            using reference = T&;
+
+            constexpr CheckedIterator() noexcept = default;
+
+            constexpr CheckedIterator(T* ptr, const Owner* owner, size_t generation) noexcept
+                : ptr_(ptr)
+                , owner_(owner)
+                , generation_(generation) {
+            }
+
+            template <typename U, typename = std::enable_if_t<std::is_same_v<const U, T> && !std::is_same_v<U, T>>>
+            constexpr CheckedIterator(const CheckedIterator<U, Owner>& other) noexcept
+                : ptr_(other.Base())
+                , owner_(other.Container())
+                , generation_(other.Generation()) {
+            }
+
+            constexpr T& operator*() const noexcept {
+                CheckDereferenceable();
+                return *ptr_;
+            }
+
+            constexpr T* operator->() const noexcept {
+                CheckDereferenceable();
+                return ptr_;
+            }
+
+            constexpr T& operator[](difference_type n) const noexcept {
+                return *(*this + n);
+            }
+
+            constexpr CheckedIterator& operator++() noexcept {
+                ++ptr_;
+                return *this;
+            }
+
+            constexpr CheckedIterator operator++(int) noexcept {
+                CheckedIterator tmp = *this;
+                ++ptr_;
+                return tmp;
+            }
+
+            constexpr CheckedIterator& operator--() noexcept {
+                --ptr_;
+                return *this;
+            }
+
+            constexpr CheckedIterator operator--(int) noexcept {
+                CheckedIterator tmp = *this;
+                --ptr_;
+                return tmp;
+            }
+
+            constexpr CheckedIterator& operator+=(difference_type n) noexcept {
+                ptr_ += n;
+                return *this;
+            }
+
+            constexpr CheckedIterator& operator-=(difference_type n) noexcept {
+                ptr_ -= n;
+                return *this;
+            }
+
+            friend constexpr CheckedIterator operator+(CheckedIterator it, difference_type n) noexcept {
+                return it += n;
+            }
+
+            friend constexpr CheckedIterator operator+(difference_type n, CheckedIterator it) noexcept {
+                return it += n;
+            }
+
+            friend constexpr CheckedIterator operator-(CheckedIterator it, difference_type n) noexcept {
+                return it -= n;
+            }
+
+            friend constexpr difference_type operator-(const CheckedIterator& lhs, const CheckedIterator& rhs) noexcept {
+                lhs.CheckComparable(rhs);
+                return lhs.ptr_ - rhs.ptr_;
+            }
+
+            friend constexpr bool operator==(const CheckedIterator& lhs, const CheckedIterator& rhs) noexcept {
+                lhs.CheckComparable(rhs);
+                return lhs.ptr_ == rhs.ptr_;
+            }
+
+            friend constexpr bool operator!=(const CheckedIterator& lhs, const CheckedIterator& rhs) noexcept {
+                return !(lhs == rhs);
+            }
+
+            friend constexpr bool operator<(const CheckedIterator& lhs, const CheckedIterator& rhs) noexcept {
+                lhs.CheckComparable(rhs);
+                return lhs.ptr_ < rhs.ptr_;
+            }
+
+            friend constexpr bool operator>(const CheckedIterator& lhs, const CheckedIterator& rhs) noexcept {
+                return rhs < lhs;
+            }
+
+            friend constexpr bool operator<=(const CheckedIterator& lhs, const CheckedIterator& rhs) noexcept {
+                return !(rhs < lhs);
+            }
+
+            friend constexpr bool operator>=(const CheckedIterator& lhs, const CheckedIterator& rhs) noexcept {
+                return !(lhs < rhs);
+            }
+
+            constexpr T* Base() const noexcept {
+                return ptr_;
+            }
+
+            // The raw pointer after verifying the iterator still refers to owner's live storage
+            constexpr T* CheckedBase(const Owner* owner) const noexcept {
+                if (owner_ != owner) {
+                    HardeningFailure("iterator belongs to a different container");
+                }
+                CheckValid();
+                if (ptr_ < owner_->Data() || ptr_ > owner_->Data() + owner_->Size()) {
+                    HardeningFailure("iterator out of range");
+                }
+                return ptr_;
+            }
+
+            constexpr const Owner* Container() const noexcept {
+                return owner_;
+            }
+
+            constexpr size_t Generation() const noexcept {
+                return generation_;
+            }
+
+        private:
+            constexpr void CheckValid() const noexcept {
+                if (owner_ == nullptr) {
+                    HardeningFailure("singular iterator used");
+                }
+                if (owner_->Generation() != generation_) {
+                    HardeningFailure("iterator used after the container reallocated");
+                }
+            }
+
+            constexpr void CheckDereferenceable() const noexcept {
+                CheckValid();
+                if (ptr_ < owner_->Data() || ptr_ >= owner_->Data() + owner_->Size()) {
+                    HardeningFailure("dereferenced iterator out of range");
+                }
+            }
+
+            constexpr void CheckComparable(const CheckedIterator& other) const noexcept {
+                if (owner_ != other.owner_) {
+                    HardeningFailure("compared iterators of different containers");
+                }
+            }
+
+        private:
+            T* ptr_ = nullptr;
+            const Owner* owner_ = nullptr;
+            size_t generation_ = 0;
+        };
+    }//namespace detail
+}//namespace notstd
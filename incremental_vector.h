@@ -0,0 +1,231 @@
+#pragma once
+#include <cassert>
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+#include "vector.h"
+
+namespace notstd {
+    // Growable array with O(1) worst-case EmplaceBack. When it fills up it allocates a
+    // buffer twice as large but does not relocate anything yet: each later EmplaceBack moves
+    // MigrateStep elements across, and operator[] looks in whichever buffer currently holds
+    // the index. With doubling and MigrateStep >= 1 the old buffer is always drained before
+    // the new one fills. The price is one extra compare per access and both buffers staying
+    // allocated while a migration is running.
+    template <typename T, size_t MigrateStep = 2>
+    class IncrementalVector {
+        static_assert(MigrateStep != 0, "migration must make progress on every push");
+        static_assert(std::is_nothrow_move_constructible_v<T>, "elements are migrated one push at a time and must not throw");
+
+    public:
+        template <bool IsConst>
+        class Iterator {
+        public:
+            using iterator_category = std::forward_iterator_tag;
+            using value_type = T;
+            using difference_type = std::ptrdiff_t;
+            using pointer = std::conditional_t<IsConst, const T*, T*>;
+            using reference = std::conditional_t<IsConst, const T&, T&>;
+            using owner_type = std::conditional_t<IsConst, const IncrementalVector, IncrementalVector>;
+
+            Iterator() noexcept = default;
+
+            Iterator(owner_type* owner, size_t index) noexcept
+                : owner_(owner)
+                , index_(index) {
+            }
+
+            reference operator*() const noexcept {
+                return (*owner_)[index_];
+            }
+
+            pointer operator->() const noexcept {
+                return &(*owner_)[index_];
+            }
+
+            Iterator& operator++() noexcept {
+                ++index_;
+                return *this;
+            }
+
+            Iterator operator++(int) noexcept {
+                Iterator tmp = *this;
+                ++index_;
+                return tmp;
+            }
+
+            friend bool operator==(const Iterator& lhs, const Iterator& rhs) noexcept {
+                return lhs.index_ == rhs.index_;
+            }
+
+            friend bool operator!=(const Iterator& lhs, const Iterator& rhs) noexcept {
+                return lhs.index_ != rhs.index_;
+            }
+
+        private:
+            owner_type* owner_ = nullptr;
+            size_t index_ = 0;
+        };
+
+        using iterator = Iterator<false>;
+        using const_iterator = Iterator<true>;
+
+        IncrementalVector() = default;
+
+        IncrementalVector(const IncrementalVector&) = delete;
+        IncrementalVector& operator=(const IncrementalVector&) = delete;
+
+        IncrementalVector(IncrementalVector&& other) noexcept
+            : old_(std::move(other.old_))
+            , new_(std::move(other.new_))
+            , size_(std::exchange(other.size_, 0))
+            , migrated_(std::exchange(other.migrated_, 0))
+            , old_size_(std::exchange(other.old_size_, 0)) {
+        }
+
+        IncrementalVector& operator=(IncrementalVector&& rhs) noexcept {
+            if (this != &rhs) {
+                Clear();
+                old_ = std::move(rhs.old_);
+                new_ = std::move(rhs.new_);
+                size_ = std::exchange(rhs.size_, 0);
+                migrated_ = std::exchange(rhs.migrated_, 0);
+                old_size_ = std::exchange(rhs.old_size_, 0);
+            }
+            return *this;
+        }
+
+        ~IncrementalVector() {
+            Clear();
+        }
+
+        iterator begin() noexcept {
+            return iterator(this, 0);
+        }
+
+        iterator end() noexcept {
+            return iterator(this, size_);
+        }
+
+        const_iterator begin() const noexcept {
+            return const_iterator(this, 0);
+        }
+
+        const_iterator end() const noexcept {
+            return const_iterator(this, size_);
+        }
+
+        template <typename... Args>
+        T& EmplaceBack(Args&&... args) {
+            if (size_ == new_.Capacity()) {
+                StartMigration();
+            }
+            T& result = *detail::ConstructAt(new_ + size_, std::forward<Args>(args)...);
+            ++size_;
+            Migrate(MigrateStep);
+            return result;
+        }
+
+        template <typename V>
+        void PushBack(V&& value) {
+            EmplaceBack(std::forward<V>(value));
+        }
+
+        void PopBack() noexcept {
+            assert(size_ != 0);
+            size_t last = size_ - 1;
+            std::destroy_at(&(*this)[last]);
+            size_ = last;
+            if (last < old_size_) {
+                old_size_ = last;
+                migrated_ = migrated_ < last ? migrated_ : last;
+                Migrate(0);
+            }
+        }
+
+        const T& operator[](size_t index) const noexcept {
+            return const_cast<IncrementalVector&>(*this)[index];
+        }
+
+        T& operator[](size_t index) noexcept {
+            assert(index < size_);
+            // one unsigned compare for migrated_ <= index < old_size_
+            return index - migrated_ < old_size_ - migrated_ ? old_[index] : new_[index];
+        }
+
+        T& Back() noexcept {
+            return (*this)[size_ - 1];
+        }
+
+        const T& Back() const noexcept {
+            return (*this)[size_ - 1];
+        }
+
+        size_t Size() const noexcept {
+            return size_;
+        }
+
+        bool Empty() const noexcept {
+            return size_ == 0;
+        }
+
+        size_t Capacity() const noexcept {
+            return new_.Capacity();
+        }
+
+        bool IsMigrating() const noexcept {
+            return old_.Capacity() != 0;
+        }
+
+        // Completes a pending migration now, e.g. while idle, and frees the old buffer
+        void FinishMigration() noexcept {
+            Migrate(old_size_ - migrated_);
+        }
+
+        void Clear() noexcept {
+            for (size_t i = 0; i < size_; ++i) {
+                std::destroy_at(&(*this)[i]);
+            }
+            size_ = migrated_ = old_size_ = 0;
+            RawMemory<T>().Swap(old_);
+        }
+
+    private:
+        void StartMigration() {
+            FinishMigration();
+            RawMemory<T> larger = new_.Replacement(size_ == 0 ? 1 : size_ * 2);
+            old_ = std::move(new_);
+            new_ = std::move(larger);
+            old_size_ = size_;
+            migrated_ = 0;
+        }
+
+        // Moves up to count elements from the old buffer and frees it once drained
+        void Migrate(size_t count) noexcept {
+            if (!IsMigrating()) {
+                return;
+            }
+            size_t end = old_size_ - migrated_ < count ? old_size_ : migrated_ + count;
+            for (; migrated_ < end; ++migrated_) {
+                detail::ConstructAt(new_ + migrated_, std::move(old_[migrated_]));
+                std::destroy_at(old_ + migrated_);
+            }
+            if (migrated_ == old_size_) {
+                RawMemory<T>().Swap(old_);
+                migrated_ = old_size_ = 0;
+            }
+        }
+
+    private:
+        // buffer being drained; holds indices [migrated_, old_size_)
+        RawMemory<T> old_;
+        // current buffer; holds every other index
+        RawMemory<T> new_;
+        size_t size_ = 0;
+        size_t migrated_ = 0;
+        size_t old_size_ = 0;
+    };
+}//namespace notstd
@@ -0,0 +1,190 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <limits>
+#include <new>
+#include <string>
+#include <utility>
+
+// Opt-in allocation accounting: build with -DNOTSTD_MEMORY_BUDGET=1 for RawMemory (and so
+// every container built on it) to charge the budget of the active BudgetScope. That costs
+// a budget pointer per RawMemory, growing a Vector from 24 to 32 bytes; with the default of 0
+// budgets can still be charged directly, but containers never touch them.
+#ifndef NOTSTD_MEMORY_BUDGET
+#define NOTSTD_MEMORY_BUDGET 0
+#endif
+
+namespace notstd {
+    class MemoryBudget;
+
+    // Thrown by RawMemory when an allocation would take a budget past its limit.
+    // Derives from std::bad_alloc so existing out-of-memory handling keeps working.
+    class BudgetExceeded : public std::bad_alloc {
+    public:
+        BudgetExceeded(const MemoryBudget& budget, size_t requested) noexcept
+            : budget_(&budget)
+            , requested_(requested) {
+        }
+
+        const char* what() const noexcept override {
+            return "notstd::BudgetExceeded";
+        }
+
+        const MemoryBudget& Budget() const noexcept {
+            return *budget_;
+        }
+
+        size_t Requested() const noexcept {
+            return requested_;
+        }
+
+    private:
+        const MemoryBudget* budget_;
+        size_t requested_;
+    };
+
+    // A node in a hierarchy of byte budgets (e.g. process -> tenant -> request). Every
+    // RawMemory allocation made while a BudgetScope is active is charged to that budget and
+    // all of its ancestors before operator new is called, and credited back on release.
+    // Containers that reallocate charge the new buffer to the old one's budget, wherever they
+    // grow. A budget must outlive every allocation charged to it.
+    class MemoryBudget {
+    public:
+        static constexpr size_t kUnlimited = std::numeric_limits<size_t>::max();
+
+        enum class OverLimit {
+            // throw BudgetExceeded and leave all counters unchanged
+            kReject,
+            // call the handler and let the allocation proceed
+            kSignal,
+        };
+
+        using Handler = std::function<void(const MemoryBudget& budget, size_t requested)>;
+
+        explicit MemoryBudget(std::string name, size_t limit = kUnlimited, MemoryBudget* parent = nullptr,
+                              OverLimit policy = OverLimit::kReject)
+            : name_(std::move(name))
+            , parent_(parent)
+            , limit_(limit)
+            , policy_(policy) {
+        }
+
+        MemoryBudget(const MemoryBudget&) = delete;
+        MemoryBudget& operator=(const MemoryBudget&) = delete;
+
+        // Called once per allocation that crosses the limit under OverLimit::kSignal, after
+        // every ancestor has accepted the charge. If it throws, the charge is undone and the
+        // allocation fails. Must be set before allocations are charged concurrently.
+        void SetHandler(Handler handler) {
+            handler_ = std::move(handler);
+        }
+
+        // Charges this budget and then its ancestors. Peaks are raised only once the whole
+        // chain has accepted, so a rejection leaves every counter as it was.
+        void Charge(size_t bytes) {
+            size_t live;
+            if (!TryCharge(bytes, live)) {
+                throw BudgetExceeded(*this, bytes);
+            }
+            if (parent_ != nullptr) {
+                try {
+                    parent_->Charge(bytes);
+                } catch (...) {
+                    live_.fetch_sub(bytes, std::memory_order_relaxed);
+                    throw;
+                }
+            }
+            size_t peak = peak_.load(std::memory_order_relaxed);
+            while (live > peak && !peak_.compare_exchange_weak(peak, live, std::memory_order_relaxed)) {
+            }
+            // only kSignal lets live exceed the limit
+            if (live > limit_ && handler_) {
+                try {
+                    handler_(*this, bytes);
+                } catch (...) {
+                    Release(bytes);
+                    throw;
+                }
+            }
+        }
+
+        void Release(size_t bytes) noexcept {
+            for (MemoryBudget* budget = this; budget != nullptr; budget = budget->parent_) {
+                budget->live_.fetch_sub(bytes, std::memory_order_relaxed);
+            }
+        }
+
+        size_t Live() const noexcept {
+            return live_.load(std::memory_order_relaxed);
+        }
+
+        size_t Peak() const noexcept {
+            return peak_.load(std::memory_order_relaxed);
+        }
+
+        void ResetPeak() noexcept {
+            peak_.store(Live(), std::memory_order_relaxed);
+        }
+
+        size_t Limit() const noexcept {
+            return limit_;
+        }
+
+        const std::string& Name() const noexcept {
+            return name_;
+        }
+
+        MemoryBudget* Parent() const noexcept {
+            return parent_;
+        }
+
+        // Budget charged by allocations on the calling thread, or nullptr
+        static MemoryBudget* Current() noexcept {
+            return current_;
+        }
+
+    private:
+        friend class BudgetScope;
+
+        // Adds bytes to live unless that is rejected; live receives the new value
+        bool TryCharge(size_t bytes, size_t& live) noexcept {
+            live = live_.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+            if (live > limit_ && policy_ == OverLimit::kReject) {
+                live_.fetch_sub(bytes, std::memory_order_relaxed);
+                return false;
+            }
+            return true;
+        }
+
+    private:
+        std::string name_;
+        MemoryBudget* parent_;
+        size_t limit_;
+        OverLimit policy_;
+        Handler handler_;
+        std::atomic<size_t> live_{0};
+        std::atomic<size_t> peak_{0};
+
+        static inline thread_local MemoryBudget* current_ = nullptr;
+    };
+
+    // Makes budget the one charged by RawMemory allocations on this thread until the scope ends
+    class BudgetScope {
+    public:
+        explicit BudgetScope(MemoryBudget& budget) noexcept
+            : previous_(MemoryBudget::current_) {
+            MemoryBudget::current_ = &budget;
+        }
+
+        BudgetScope(const BudgetScope&) = delete;
+        BudgetScope& operator=(const BudgetScope&) = delete;
+
+        ~BudgetScope() {
+            MemoryBudget::current_ = previous_;
+        }
+
+    private:
+        MemoryBudget* previous_;
+    };
+}//namespace notstd
@@ -0,0 +1,304 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <climits>
+#include <cstdint>
+#include <cstring>
+#include <future>
+#include <memory>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+#include "vector.h"
+
+namespace notstd {
+    namespace radix_detail {
+        constexpr size_t kDigitBits = 8;
+        constexpr size_t kBuckets = size_t(1) << kDigitBits;
+        // below this many elements a pass costs more than an insertion sort
+        constexpr size_t kInsertionSortThreshold = 32;
+        // below this many elements per worker the parallel sort is not worth its threads
+        constexpr size_t kMinParallelChunk = size_t(1) << 16;
+
+        // Maps a key to an unsigned integer whose natural order matches the key's order:
+        // the sign bit of signed integers is flipped, negative floats have all bits flipped
+        // and positive floats only the sign bit, so -inf < -0.0 < +0.0 < +inf.
+        template <typename K>
+        auto OrderedBits(K key) noexcept {
+            static_assert(std::is_arithmetic_v<K> || std::is_enum_v<K>, "radix sort keys must be arithmetic or enums");
+            if constexpr (std::is_enum_v<K>) {
+                return OrderedBits(static_cast<std::underlying_type_t<K>>(key));
+            } else if constexpr (std::is_same_v<K, bool>) {
+                return static_cast<uint8_t>(key);
+            } else if constexpr (std::is_floating_point_v<K>) {
+                static_assert(sizeof(K) == 4 || sizeof(K) == 8, "only 32 and 64 bit floating point keys are supported");
+                using U = std::conditional_t<sizeof(K) == 4, uint32_t, uint64_t>;
+                constexpr U sign = U(1) << (sizeof(U) * CHAR_BIT - 1);
+                U bits;
+                std::memcpy(&bits, &key, sizeof(bits));
+                return (bits & sign) != 0 ? static_cast<U>(~bits) : static_cast<U>(bits | sign);
+            } else if constexpr (std::is_signed_v<K>) {
+                using U = std::make_unsigned_t<K>;
+                constexpr U sign = U(1) << (sizeof(U) * CHAR_BIT - 1);
+                return static_cast<U>(static_cast<U>(key) ^ sign);
+            } else {
+                return key;
+            }
+        }
+
+        template <typename T, typename KeyFn>
+        using EnableIfKey = std::enable_if_t<std::is_invocable_v<const KeyFn&, const T&>>;
+
+        template <typename T, typename KeyFn>
+        using BitsOf = decltype(OrderedBits(std::declval<const KeyFn&>()(std::declval<const T&>())));
+
+        template <typename T, typename KeyFn>
+        constexpr size_t kDigits = sizeof(BitsOf<T, KeyFn>);
+
+        struct Identity {
+            template <typename T>
+            constexpr const T& operator()(const T& value) const noexcept {
+                return value;
+            }
+        };
+
+        template <typename Bits>
+        size_t Digit(Bits bits, size_t digit) noexcept {
+            return static_cast<size_t>(bits >> (digit * kDigitBits)) & (kBuckets - 1);
+        }
+
+        // A pass over a digit every element shares would only copy the data
+        inline bool IsConstant(const size_t* counts, size_t n) noexcept {
+            for (size_t bucket = 0; bucket < kBuckets; ++bucket) {
+                if (counts[bucket] != 0) {
+                    return counts[bucket] == n;
+                }
+            }
+            return true;
+        }
+
+        template <typename T>
+        void Relocate(T* from, size_t n, T* to) noexcept {
+            if constexpr (std::is_trivially_copyable_v<T>) {
+                std::memcpy(static_cast<void*>(to), from, n * sizeof(T));
+            } else {
+                for (size_t i = 0; i < n; ++i) {
+                    detail::ConstructAt(to + i, std::move(from[i]));
+                    std::destroy_at(from + i);
+                }
+            }
+        }
+
+        // Relocates src[0, n) into dst, placing each element at the next offset of its bucket
+        template <typename T, typename KeyFn>
+        void Scatter(T* src, size_t n, T* dst, const KeyFn& key, size_t digit, size_t* offsets) noexcept {
+            for (size_t i = 0; i < n; ++i) {
+                T* slot = dst + offsets[Digit(OrderedBits(key(src[i])), digit)]++;
+                detail::ConstructAt(slot, std::move(src[i]));
+                std::destroy_at(src + i);
+            }
+        }
+
+        template <typename T, typename KeyFn>
+        void InsertionSort(T* data, size_t n, const KeyFn& key) noexcept {
+            for (size_t i = 1; i < n; ++i) {
+                auto bits = OrderedBits(key(data[i]));
+                size_t j = i;
+                if (!(bits < OrderedBits(key(data[j - 1])))) {
+                    continue;
+                }
+                T tmp = std::move(data[i]);
+                for (; j > 0 && bits < OrderedBits(key(data[j - 1])); --j) {
+                    data[j] = std::move(data[j - 1]);
+                }
+                data[j] = std::move(tmp);
+            }
+        }
+
+        // Stable LSD sort of src[0, n) on the low `digits` digits of the key, ping-ponging
+        // with the uninitialized dst. Returns whichever of the two holds the result; the
+        // other is left uninitialized.
+        template <typename T, typename KeyFn>
+        T* LsdSort(T* src, T* dst, size_t n, const KeyFn& key, size_t digits) noexcept {
+            if (n <= kInsertionSortThreshold) {
+                InsertionSort(src, n, key);
+                return src;
+            }
+            size_t counts[kDigits<T, KeyFn>][kBuckets] = {};
+            for (size_t i = 0; i < n; ++i) {
+                auto bits = OrderedBits(key(src[i]));
+                for (size_t digit = 0; digit < digits; ++digit) {
+                    ++counts[digit][Digit(bits, digit)];
+                }
+            }
+            for (size_t digit = 0; digit < digits; ++digit) {
+                if (IsConstant(counts[digit], n)) {
+                    continue;
+                }
+                size_t offset = 0;
+                for (size_t& count : counts[digit]) {
+                    offset += std::exchange(count, offset);
+                }
+                Scatter(src, n, dst, key, digit, counts[digit]);
+                std::swap(src, dst);
+            }
+            return src;
+        }
+
+        // Runs fn(0) .. fn(workers - 1) concurrently. Never throws: workers that cannot get a
+        // thread run on the caller, since a pass abandoned halfway would lose elements.
+        template <typename Fn>
+        void RunWorkers(size_t workers, const Fn& fn) noexcept {
+            Vector<std::future<void>> threads;
+            size_t started = 1;
+            try {
+                threads.Reserve(workers - 1);
+                for (; started < workers; ++started) {
+                    threads.PushBack(std::async(std::launch::async, fn, started));
+                }
+            } catch (...) {
+            }
+            for (size_t worker = started; worker < workers; ++worker) {
+                fn(worker);
+            }
+            fn(0);
+            for (std::future<void>& thread : threads) {
+                thread.wait();
+            }
+        }
+    }//namespace radix_detail
+
+    // Stable radix sort by key(item), which must return an arithmetic or enum value and not
+    // throw. Sorts in O(n * key bytes) using one scratch buffer of n elements; byte positions
+    // on which all keys agree are skipped, so small values in wide keys sort in few passes.
+    template <typename T, typename KeyFn, typename = radix_detail::EnableIfKey<T, KeyFn>>
+    void RadixSort(Span<T> items, KeyFn key) {
+        static_assert(std::is_nothrow_move_constructible_v<T>, "radix sort relocates elements and must not throw midway");
+        if (items.Size() < 2) {
+            return;
+        }
+        RawMemory<T> scratch(items.Size());
+        T* sorted = radix_detail::LsdSort(items.Data(), scratch.GetAddress(), items.Size(), key,
+                                          radix_detail::kDigits<T, KeyFn>);
+        if (sorted != items.Data()) {
+            radix_detail::Relocate(sorted, items.Size(), items.Data());
+        }
+    }
+
+    template <typename T>
+    void RadixSort(Span<T> items) {
+        RadixSort(items, radix_detail::Identity{});
+    }
+
+    template <typename T, typename KeyFn, typename = radix_detail::EnableIfKey<T, KeyFn>>
+    void RadixSort(Vector<T>& items, KeyFn key) {
+        RadixSort(items.AsSpan(), std::move(key));
+    }
+
+    template <typename T>
+    void RadixSort(Vector<T>& items) {
+        RadixSort(items.AsSpan(), radix_detail::Identity{});
+    }
+
+    // Multi-threaded RadixSort. One parallel MSD pass partitions the items on their most
+    // significant varying byte, then workers take the resulting buckets and finish each with
+    // a sequential LSD sort. Scales with threads while keys spread across buckets; a single
+    // dominant bucket leaves the final stage sequential. threads == 0 uses every core.
+    template <typename T, typename KeyFn, typename = radix_detail::EnableIfKey<T, KeyFn>>
+    void ParallelRadixSort(Span<T> items, KeyFn key, size_t threads = 0) {
+        static_assert(std::is_nothrow_move_constructible_v<T>, "radix sort relocates elements and must not throw midway");
+        using namespace radix_detail;
+        constexpr size_t digits = kDigits<T, KeyFn>;
+        using Counts = std::array<std::array<size_t, kBuckets>, digits>;
+
+        const size_t n = items.Size();
+        if (threads == 0) {
+            threads = std::max(1u, std::thread::hardware_concurrency());
+        }
+        threads = std::min(threads, n / kMinParallelChunk);
+        if (threads < 2) {
+            RadixSort(items, std::move(key));
+            return;
+        }
+        T* data = items.Data();
+        auto block_begin = [&](size_t block) {
+            return n / threads * block + std::min(block, n % threads);
+        };
+
+        Vector<Counts> counts(threads);
+        RunWorkers(threads, [&](size_t block) {
+            Counts& local = counts[block];
+            for (size_t i = block_begin(block); i < block_begin(block + 1); ++i) {
+                auto bits = OrderedBits(key(data[i]));
+                for (size_t digit = 0; digit < digits; ++digit) {
+                    ++local[digit][Digit(bits, digit)];
+                }
+            }
+        });
+
+        Counts total{};
+        for (const Counts& local : counts) {
+            for (size_t digit = 0; digit < digits; ++digit) {
+                for (size_t bucket = 0; bucket < kBuckets; ++bucket) {
+                    total[digit][bucket] += local[digit][bucket];
+                }
+            }
+        }
+        size_t top = digits;
+        while (top > 0 && IsConstant(total[top - 1].data(), n)) {
+            --top;
+        }
+        if (top == 0) {
+            return;
+        }
+        const size_t msd = top - 1;
+
+        // bucket b of block k starts after all smaller buckets and after bucket b of blocks < k
+        std::array<size_t, kBuckets + 1> bucket_begin{};
+        for (size_t bucket = 0; bucket < kBuckets; ++bucket) {
+            bucket_begin[bucket + 1] = bucket_begin[bucket] + total[msd][bucket];
+        }
+        for (size_t bucket = 0; bucket < kBuckets; ++bucket) {
+            size_t offset = bucket_begin[bucket];
+            for (Counts& local : counts) {
+                offset += std::exchange(local[msd][bucket], offset);
+            }
+        }
+
+        RawMemory<T> scratch(n);
+        T* spare = scratch.GetAddress();
+        RunWorkers(threads, [&](size_t block) {
+            size_t begin = block_begin(block);
+            Scatter(data + begin, block_begin(block + 1) - begin, spare, key, msd, counts[block][msd].data());
+        });
+
+        std::atomic<size_t> next{0};
+        RunWorkers(threads, [&](size_t) {
+            for (size_t bucket = next++; bucket < kBuckets; bucket = next++) {
+                size_t begin = bucket_begin[bucket];
+                size_t size = bucket_begin[bucket + 1] - begin;
+                T* sorted = LsdSort(spare + begin, data + begin, size, key, msd);
+                if (sorted != data + begin) {
+                    Relocate(sorted, size, data + begin);
+                }
+            }
+        });
+    }
+
+    template <typename T>
+    void ParallelRadixSort(Span<T> items, size_t threads = 0) {
+        ParallelRadixSort(items, radix_detail::Identity{}, threads);
+    }
+
+    template <typename T, typename KeyFn, typename = radix_detail::EnableIfKey<T, KeyFn>>
+    void ParallelRadixSort(Vector<T>& items, KeyFn key, size_t threads = 0) {
+        ParallelRadixSort(items.AsSpan(), std::move(key), threads);
+    }
+
+    template <typename T>
+    void ParallelRadixSort(Vector<T>& items, size_t threads = 0) {
+        ParallelRadixSort(items.AsSpan(), radix_detail::Identity{}, threads);
+    }
+}//namespace notstd
@@ -0,0 +1,239 @@
+#pragma once
+#include <cassert>
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <utility>
+
+#include "vector.h"
+
+namespace notstd {
+    // Growable sequence that never relocates its elements, so T may be neither movable
+    // nor copyable (mutexes, atomics). Storage is a list of segments whose capacities
+    // double (FirstSegment, 2 * FirstSegment, ...); elements are contiguous within a segment
+    // and references stay valid until the element is destroyed.
+    template <typename T, size_t FirstSegment = 16>
+    class SegmentedVector {
+        static_assert(FirstSegment != 0 && (FirstSegment & (FirstSegment - 1)) == 0,
+                      "first segment capacity must be a power of two");
+
+    public:
+        template <bool IsConst>
+        class Iterator {
+        public:
+            using iterator_category = std::forward_iterator_tag;
+            using value_type = T;
+            using difference_type = std::ptrdiff_t;
+            using pointer = std::conditional_t<IsConst, const T*, T*>;
+            using reference = std::conditional_t<IsConst, const T&, T&>;
+            using owner_type = std::conditional_t<IsConst, const SegmentedVector, SegmentedVector>;
+
+            Iterator() noexcept = default;
+
+            Iterator(owner_type* owner, size_t index) noexcept
+                : owner_(owner)
+                , index_(index) {
+                Locate();
+            }
+
+            reference operator*() const noexcept {
+                return *ptr_;
+            }
+
+            pointer operator->() const noexcept {
+                return ptr_;
+            }
+
+            Iterator& operator++() noexcept {
+                ++index_;
+                if (++ptr_ == segment_end_) {
+                    Locate();
+                }
+                return *this;
+            }
+
+            Iterator operator++(int) noexcept {
+                Iterator tmp = *this;
+                ++*this;
+                return tmp;
+            }
+
+            friend bool operator==(const Iterator& lhs, const Iterator& rhs) noexcept {
+                return lhs.index_ == rhs.index_;
+            }
+
+            friend bool operator!=(const Iterator& lhs, const Iterator& rhs) noexcept {
+                return lhs.index_ != rhs.index_;
+            }
+
+        private:
+            void Locate() noexcept {
+                if (index_ >= owner_->size_) {
+                    ptr_ = segment_end_ = nullptr;
+                    return;
+                }
+                size_t segment = SegmentOf(index_);
+                ptr_ = &(*owner_)[index_];
+                segment_end_ = ptr_ + (SegmentCapacity(segment) - (index_ - SegmentStart(segment)));
+            }
+
+            owner_type* owner_ = nullptr;
+            size_t index_ = 0;
+            pointer ptr_ = nullptr;
+            pointer segment_end_ = nullptr;
+        };
+
+        using iterator = Iterator<false>;
+        using const_iterator = Iterator<true>;
+
+        SegmentedVector() = default;
+
+        SegmentedVector(const SegmentedVector&) = delete;
+        SegmentedVector& operator=(const SegmentedVector&) = delete;
+
+        SegmentedVector(SegmentedVector&& other) noexcept
+            : segments_(std::move(other.segments_))
+            , size_(other.size_) {
+            other.size_ = 0;
+        }
+
+        SegmentedVector& operator=(SegmentedVector&& rhs) noexcept {
+            if (this != &rhs) {
+                Clear();
+                segments_ = std::move(rhs.segments_);
+                size_ = rhs.size_;
+                rhs.size_ = 0;
+            }
+            return *this;
+        }
+
+        ~SegmentedVector() {
+            Clear();
+        }
+
+        iterator begin() noexcept {
+            return iterator(this, 0);
+        }
+
+        iterator end() noexcept {
+            return iterator(this, size_);
+        }
+
+        const_iterator begin() const noexcept {
+            return const_iterator(this, 0);
+        }
+
+        const_iterator end() const noexcept {
+            return const_iterator(this, size_);
+        }
+
+        template <typename... Args>
+        T& EmplaceBack(Args&&... args) {
+            size_t segment = SegmentOf(size_);
+            if (segment == segments_.Size()) {
+                segments_.EmplaceBack(SegmentCapacity(segment));
+            }
+            T* slot = Slot(size_);
+            detail::ConstructAt(slot, std::forward<Args>(args)...);
+            ++size_;
+            return *slot;
+        }
+
+        void PopBack() noexcept {
+            assert(size_ > 0);
+            --size_;
+            std::destroy_at(Slot(size_));
+        }
+
+        // Destroys all elements but keeps the allocated segments for reuse
+        void Clear() noexcept {
+            for (size_t segment = 0; segment < segments_.Size() && SegmentStart(segment) < size_; ++segment) {
+                std::destroy_n(segments_[segment].GetAddress(), SegmentSize(segment));
+            }
+            size_ = 0;
+        }
+
+        // Releases segments that hold no elements
+        void ShrinkToFit() {
+            size_t used = size_ == 0 ? 0 : SegmentOf(size_ - 1) + 1;
+            while (segments_.Size() > used) {
+                segments_.PopBack();
+            }
+        }
+
+        const T& operator[](size_t index) const noexcept {
+            return const_cast<SegmentedVector&>(*this)[index];
+        }
+
+        T& operator[](size_t index) noexcept {
+            assert(index < size_);
+            return *Slot(index);
+        }
+
+        size_t Size() const noexcept {
+            return size_;
+        }
+
+        size_t Capacity() const noexcept {
+            return SegmentStart(segments_.Size());
+        }
+
+        size_t SegmentCount() const noexcept {
+            return segments_.Size();
+        }
+
+        // Contiguous elements stored in the given segment
+        Span<T> Segment(size_t segment) noexcept {
+            assert(segment < segments_.Size());
+            return Span<T>(segments_[segment].GetAddress(), SegmentSize(segment));
+        }
+
+        Span<const T> Segment(size_t segment) const noexcept {
+            assert(segment < segments_.Size());
+            return Span<const T>(segments_[segment].GetAddress(), SegmentSize(segment));
+        }
+
+    private:
+        static size_t Log2Floor(size_t value) noexcept {
+#if defined(__GNUC__) || defined(__clang__)
+            return sizeof(unsigned long long) * 8 - 1 - __builtin_clzll(value);
+#else
+            size_t result = 0;
+            while (value >>= 1) {
+                ++result;
+            }
+            return result;
+#endif
+        }
+
+        static size_t SegmentOf(size_t index) noexcept {
+            return Log2Floor(index / FirstSegment + 1);
+        }
+
+        static size_t SegmentStart(size_t segment) noexcept {
+            return FirstSegment * ((size_t(1) << segment) - 1);
+        }
+
+        static size_t SegmentCapacity(size_t segment) noexcept {
+            return FirstSegment << segment;
+        }
+
+        T* Slot(size_t index) noexcept {
+            size_t segment = SegmentOf(index);
+            return segments_[segment] + (index - SegmentStart(segment));
+        }
+
+        size_t SegmentSize(size_t segment) const noexcept {
+            size_t start = SegmentStart(segment);
+            if (size_ <= start) {
+                return 0;
+            }
+            size_t in_segment = size_ - start;
+            return in_segment < SegmentCapacity(segment) ? in_segment : SegmentCapacity(segment);
+        }
+
+    private:
+        Vector<RawMemory<T>> segments_;
+        size_t size_ = 0;
+    };
+}//namespace notstd
@@ -0,0 +1,204 @@
+#pragma once
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstring>
+#include <utility>
+
+#include "vector.h"
+
+namespace notstd {
+    namespace shared_detail {
+        // Heap block shared by a SharedBuffer and all slices of it. The bytes are freed, and
+        // their budget credited, when the last reference goes away.
+        struct Control {
+            Control(RawMemory<std::byte> memory, size_t size) noexcept
+                : memory(std::move(memory))
+                , size(size) {
+            }
+
+            std::atomic<size_t> refs{1};
+            RawMemory<std::byte> memory;
+            size_t size;
+        };
+
+        inline void Acquire(Control* control) noexcept {
+            if (control != nullptr) {
+                control->refs.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+
+        inline void Release(Control* control) noexcept {
+            if (control != nullptr && control->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                delete control;
+            }
+        }
+    }//namespace shared_detail
+
+    // Immutable view of part of a SharedBuffer that keeps the whole buffer alive. Copying
+    // a slice only bumps the reference count.
+    class SharedSlice {
+    public:
+        SharedSlice() noexcept = default;
+
+        SharedSlice(const SharedSlice& other) noexcept
+            : control_(other.control_)
+            , data_(other.data_)
+            , size_(other.size_) {
+            shared_detail::Acquire(control_);
+        }
+
+        SharedSlice(SharedSlice&& other) noexcept
+            : control_(std::exchange(other.control_, nullptr))
+            , data_(std::exchange(other.data_, nullptr))
+            , size_(std::exchange(other.size_, 0)) {
+        }
+
+        SharedSlice& operator=(SharedSlice rhs) noexcept {
+            Swap(rhs);
+            return *this;
+        }
+
+        ~SharedSlice() {
+            shared_detail::Release(control_);
+        }
+
+        void Swap(SharedSlice& other) noexcept {
+            std::swap(control_, other.control_);
+            std::swap(data_, other.data_);
+            std::swap(size_, other.size_);
+        }
+
+        const std::byte* Data() const noexcept {
+            return data_;
+        }
+
+        size_t Size() const noexcept {
+            return size_;
+        }
+
+        bool Empty() const noexcept {
+            return size_ == 0;
+        }
+
+        Span<const std::byte> AsSpan() const noexcept {
+            return Span<const std::byte>(data_, size_);
+        }
+
+        operator Span<const std::byte>() const noexcept {
+            return AsSpan();
+        }
+
+        SharedSlice Subslice(size_t offset, size_t count = dynamic_extent) const noexcept {
+            assert(offset <= size_);
+            assert(count == dynamic_extent || count <= size_ - offset);
+            shared_detail::Acquire(control_);
+            return SharedSlice(control_, data_ + offset, count == dynamic_extent ? size_ - offset : count);
+        }
+
+        // Number of SharedBuffers and slices referring to the same bytes
+        size_t UseCount() const noexcept {
+            return control_ != nullptr ? control_->refs.load(std::memory_order_relaxed) : 0;
+        }
+
+    private:
+        friend class SharedBuffer;
+
+        // Adopts a reference already counted for it
+        SharedSlice(shared_detail::Control* control, const std::byte* data, size_t size) noexcept
+            : control_(control)
+            , data_(data)
+            , size_(size) {
+        }
+
+    private:
+        shared_detail::Control* control_ = nullptr;
+        const std::byte* data_ = nullptr;
+        size_t size_ = 0;
+    };
+
+    // Reference-counted immutable bytes for fanning one payload out to many consumers.
+    // Copies and slices share the memory; the count is atomic, so they may be handed to and
+    // dropped on other threads.
+    class SharedBuffer {
+    public:
+        SharedBuffer() noexcept = default;
+
+        static SharedBuffer CopyOf(Span<const std::byte> bytes) {
+            RawMemory<std::byte> memory(bytes.Size());
+            if (!bytes.Empty()) {
+                std::memcpy(memory.GetAddress(), bytes.Data(), bytes.Size());
+            }
+            return SharedBuffer(new shared_detail::Control(std::move(memory), bytes.Size()));
+        }
+
+        SharedBuffer(const SharedBuffer& other) noexcept
+            : control_(other.control_) {
+            shared_detail::Acquire(control_);
+        }
+
+        SharedBuffer(SharedBuffer&& other) noexcept
+            : control_(std::exchange(other.control_, nullptr)) {
+        }
+
+        SharedBuffer& operator=(SharedBuffer rhs) noexcept {
+            std::swap(control_, rhs.control_);
+            return *this;
+        }
+
+        ~SharedBuffer() {
+            shared_detail::Release(control_);
+        }
+
+        const std::byte* Data() const noexcept {
+            return control_ != nullptr ? control_->memory.GetAddress() : nullptr;
+        }
+
+        size_t Size() const noexcept {
+            return control_ != nullptr ? control_->size : 0;
+        }
+
+        bool Empty() const noexcept {
+            return Size() == 0;
+        }
+
+        Span<const std::byte> AsSpan() const noexcept {
+            return Span<const std::byte>(Data(), Size());
+        }
+
+        operator Span<const std::byte>() const noexcept {
+            return AsSpan();
+        }
+
+        SharedSlice Slice(size_t offset, size_t count = dynamic_extent) const noexcept {
+            assert(offset <= Size());
+            assert(count == dynamic_extent || count <= Size() - offset);
+            shared_detail::Acquire(control_);
+            return SharedSlice(control_, Data() + offset, count == dynamic_extent ? Size() - offset : count);
+        }
+
+        size_t UseCount() const noexcept {
+            return control_ != nullptr ? control_->refs.load(std::memory_order_relaxed) : 0;
+        }
+
+    private:
+        friend SharedBuffer ReleaseToShared(Vector<std::byte>&& vector);
+
+        explicit SharedBuffer(shared_detail::Control* control) noexcept
+            : control_(control) {
+        }
+
+    private:
+        shared_detail::Control* control_ = nullptr;
+    };
+
+    // Hands the buffer of vector over to a SharedBuffer without copying and leaves the
+    // vector empty. The spare capacity travels with the bytes and is freed together with them.
+    inline SharedBuffer ReleaseToShared(Vector<std::byte>&& vector) {
+        auto* control = new shared_detail::Control(RawMemory<std::byte>(), vector.size_);
+        vector.Annotate(vector.data_, vector.size_, vector.data_.Capacity());
+        control->memory.Swap(vector.data_);
+        vector.size_ = 0;
+        return SharedBuffer(control);
+    }
+}//namespace notstd
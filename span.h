@@ -0,0 +1,326 @@
+#pragma once
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <type_traits>
+
+namespace notstd {
+    inline constexpr size_t dynamic_extent = static_cast<size_t>(-1);
+
+    template <typename T>
+    class StridedSpan;
+
+    template <typename T>
+    class Span {
+    public:
+        using element_type = T;
+        using value_type = std::remove_cv_t<T>;
+        using iterator = T*;
+        using const_iterator = const T*;
+
+        constexpr Span() noexcept = default;
+
+        constexpr Span(T* data, size_t size) noexcept
+            : data_(data)
+            , size_(size) {
+        }
+
+        // A template so that a literal 0 passed as the count selects the (data, size) overload
+        template <typename U, typename = std::enable_if_t<std::is_convertible_v<U (*)[], T (*)[]>>>
+        constexpr Span(U* first, U* last) noexcept
+            : data_(first)
+            , size_(static_cast<size_t>(last - first)) {
+        }
+
+        template <size_t N>
+        constexpr Span(T (&array)[N]) noexcept
+            : data_(array)
+            , size_(N) {
+        }
+
+        template <typename U, typename = std::enable_if_t<std::is_convertible_v<U (*)[], T (*)[]>>>
+        constexpr Span(const Span<U>& other) noexcept
+            : data_(other.Data())
+            , size_(other.Size()) {
+        }
+
+        constexpr iterator begin() const noexcept {
+            return data_;
+        }
+
+        constexpr iterator end() const noexcept {
+            return data_ + size_;
+        }
+
+        constexpr const_iterator cbegin() const noexcept {
+            return data_;
+        }
+
+        constexpr const_iterator cend() const noexcept {
+            return data_ + size_;
+        }
+
+        constexpr T& operator[](size_t index) const noexcept {
+            assert(index < size_);
+            return data_[index];
+        }
+
+        constexpr T* Data() const noexcept {
+            return data_;
+        }
+
+        constexpr size_t Size() const noexcept {
+            return size_;
+        }
+
+        constexpr size_t SizeBytes() const noexcept {
+            return size_ * sizeof(T);
+        }
+
+        constexpr bool Empty() const noexcept {
+            return size_ == 0;
+        }
+
+        constexpr Span Subspan(size_t offset, size_t count = dynamic_extent) const noexcept {
+            assert(offset <= size_);
+            assert(count == dynamic_extent || count <= size_ - offset);
+            return Span(data_ + offset, count == dynamic_extent ? size_ - offset : count);
+        }
+
+        constexpr Span First(size_t count) const noexcept {
+            assert(count <= size_);
+            return Span(data_, count);
+        }
+
+        constexpr Span Last(size_t count) const noexcept {
+            assert(count <= size_);
+            return Span(data_ + (size_ - count), count);
+        }
+
+        constexpr StridedSpan<T> Strided(size_t stride) const noexcept;
+
+    private:
+        T* data_ = nullptr;
+        size_t size_ = 0;
+    };
+
+    template <typename T>
+    class StridedSpan {
+    public:
+        // Holds the span's base and an element index rather than a pointer, so end() and the
+        // positions around it never form an address past the last element; only operator*
+        // and operator[] compute one
+        class Iterator {
+        public:
+            using iterator_category = std::random_access_iterator_tag;
+            using value_type = std::remove_cv_t<T>;
+            using difference_type = std::ptrdiff_t;
+            using pointer = T*;
+            using reference = T&;
+
+            constexpr Iterator() noexcept = default;
+
+            constexpr Iterator(T* base, size_t index, size_t stride) noexcept
+                : base_(base)
+                , index_(static_cast<difference_type>(index))
+                , stride_(static_cast<difference_type>(stride)) {
+            }
+
+            constexpr T& operator*() const noexcept {
+                return base_[index_ * stride_];
+            }
+
+            constexpr T* operator->() const noexcept {
+                return base_ + index_ * stride_;
+            }
+
+            constexpr T& operator[](difference_type n) const noexcept {
+                return base_[(index_ + n) * stride_];
+            }
+
+            constexpr Iterator& operator++() noexcept {
+                ++index_;
+                return *this;
+            }
+
+            constexpr Iterator operator++(int) noexcept {
+                Iterator tmp = *this;
+                ++index_;
+                return tmp;
+            }
+
+            constexpr Iterator& operator--() noexcept {
+                --index_;
+                return *this;
+            }
+
+            constexpr Iterator operator--(int) noexcept {
+                Iterator tmp = *this;
+                --index_;
+                return tmp;
+            }
+
+            constexpr Iterator& operator+=(difference_type n) noexcept {
+                index_ += n;
+                return *this;
+            }
+
+            constexpr Iterator& operator-=(difference_type n) noexcept {
+                index_ -= n;
+                return *this;
+            }
+
+            friend constexpr Iterator operator+(Iterator it, difference_type n) noexcept {
+                return it += n;
+            }
+
+            friend constexpr Iterator operator+(difference_type n, Iterator it) noexcept {
+                return it += n;
+            }
+
+            friend constexpr Iterator operator-(Iterator it, difference_type n) noexcept {
+                return it -= n;
+            }
+
+            friend constexpr difference_type operator-(const Iterator& lhs, const Iterator& rhs) noexcept {
+                return lhs.index_ - rhs.index_;
+            }
+
+            friend constexpr bool operator==(const Iterator& lhs, const Iterator& rhs) noexcept {
+                return lhs.index_ == rhs.index_;
+            }
+
+            friend constexpr bool operator!=(const Iterator& lhs, const Iterator& rhs) noexcept {
+                return lhs.index_ != rhs.index_;
+            }
+
+            friend constexpr bool operator<(const Iterator& lhs, const Iterator& rhs) noexcept {
+                return lhs.index_ < rhs.index_;
+            }
+
+            friend constexpr bool operator>(const Iterator& lhs, const Iterator& rhs) noexcept {
+                return rhs < lhs;
+            }
+
+            friend constexpr bool operator<=(const Iterator& lhs, const Iterator& rhs) noexcept {
+                return !(rhs < lhs);
+            }
+
+            friend constexpr bool operator>=(const Iterator& lhs, const Iterator& rhs) noexcept {
+                return !(lhs < rhs);
+            }
+
+        private:
+            T* base_ = nullptr;
+            difference_type index_ = 0;
+            difference_type stride_ = 1;
+        };
+
+        using iterator = Iterator;
+
+        constexpr StridedSpan() noexcept = default;
+
+        // stride is measured in elements, size is the number of visited elements
+        constexpr StridedSpan(T* data, size_t size, size_t stride) noexcept
+            : data_(data)
+            , size_(size)
+            , stride_(stride) {
+            assert(stride_ != 0);
+        }
+
+        template <typename U, typename = std::enable_if_t<std::is_convertible_v<U (*)[], T (*)[]>>>
+        constexpr StridedSpan(const StridedSpan<U>& other) noexcept
+            : data_(other.Data())
+            , size_(other.Size())
+            , stride_(other.Stride()) {
+        }
+
+        constexpr iterator begin() const noexcept {
+            return iterator(data_, 0, stride_);
+        }
+
+        constexpr iterator end() const noexcept {
+            return iterator(data_, size_, stride_);
+        }
+
+        constexpr T& operator[](size_t index) const noexcept {
+            assert(index < size_);
+            return data_[index * stride_];
+        }
+
+        constexpr T* Data() const noexcept {
+            return data_;
+        }
+
+        constexpr size_t Size() const noexcept {
+            return size_;
+        }
+
+        constexpr size_t Stride() const noexcept {
+            return stride_;
+        }
+
+        constexpr bool Empty() const noexcept {
+            return size_ == 0;
+        }
+
+        constexpr StridedSpan Subspan(size_t offset, size_t count = dynamic_extent) const noexcept {
+            assert(offset <= size_);
+            assert(count == dynamic_extent || count <= size_ - offset);
+            // an empty tail keeps data_, as the address offset strides on may lie past the end
+            T* first = offset < size_ ? data_ + offset * stride_ : data_;
+            return StridedSpan(first, count == dynamic_extent ? size_ - offset : count, stride_);
+        }
+
+        constexpr StridedSpan Strided(size_t stride) const noexcept {
+            return StridedSpan(data_, size_ == 0 ? 0 : (size_ - 1) / stride + 1, stride_ * stride);
+        }
+
+    private:
+        T* data_ = nullptr;
+        size_t size_ = 0;
+        size_t stride_ = 1;
+    };
+
+    template <typename T>
+    constexpr StridedSpan<T> Span<T>::Strided(size_t stride) const noexcept {
+        assert(stride != 0);
+        return StridedSpan<T>(data_, size_ == 0 ? 0 : (size_ - 1) / stride + 1, stride);
+    }
+
+    // Views a column of an array of structs, e.g. ColumnOf(records, &Record::key)
+    template <typename T, typename M>
+    StridedSpan<M> ColumnOf(Span<T> rows, M T::*member) noexcept {
+        static_assert(sizeof(T) % sizeof(M) == 0, "member stride must be a whole number of elements");
+        if (rows.Empty()) {
+            return StridedSpan<M>();
+        }
+        return StridedSpan<M>(&(rows.Data()->*member), rows.Size(), sizeof(T) / sizeof(M));
+    }
+
+    template <typename T>
+    Span<const std::byte> AsBytes(Span<T> span) noexcept {
+        return Span<const std::byte>(reinterpret_cast<const std::byte*>(span.Data()), span.SizeBytes());
+    }
+
+    template <typename T, typename = std::enable_if_t<!std::is_const_v<T>>>
+    Span<std::byte> AsWritableBytes(Span<T> span) noexcept {
+        return Span<std::byte>(reinterpret_cast<std::byte*>(span.Data()), span.SizeBytes());
+    }
+
+    // Reinterprets a mapped or serialized byte buffer as elements of T.
+    // The buffer must be suitably aligned and hold a whole number of elements.
+    template <typename T>
+    Span<T> SpanFromBytes(void* data, size_t size_bytes) noexcept {
+        static_assert(std::is_trivially_copyable_v<T>, "only trivially copyable types can be viewed from bytes");
+        assert(reinterpret_cast<uintptr_t>(data) % alignof(T) == 0);
+        assert(size_bytes % sizeof(T) == 0);
+        return Span<T>(static_cast<T*>(data), size_bytes / sizeof(T));
+    }
+
+    template <typename T>
+    Span<const T> SpanFromBytes(const void* data, size_t size_bytes) noexcept {
+        return SpanFromBytes<const T>(const_cast<void*>(data), size_bytes);
+    }
+}//namespace notstd
@@ -1,91 +1,373 @@
 #pragma once
+#include <algorithm>
+#include <array>
 #include <cassert>
+#include <cstdint>
 #include <cstdlib>
+#include <cstring>
+#include <iterator>
 #include <new>
+#include <stdexcept>
 #include <utility>
 #include <exception>
+#include <functional>
 #include <memory>
 
+#include "hardening.h"
+#include "memory_budget.h"
+#include "span.h"
+
+#if defined(__cpp_lib_constexpr_dynamic_alloc) && __cpp_lib_constexpr_dynamic_alloc >= 201907L
+#define NOTSTD_CONSTEXPR constexpr
+#define NOTSTD_HAS_CONSTEXPR_VECTOR 1
+#else
+#define NOTSTD_CONSTEXPR
+#define NOTSTD_HAS_CONSTEXPR_VECTOR 0
+#endif
+
 namespace notstd {
+    namespace detail {
+        constexpr bool IsConstantEvaluated() noexcept {
+#if NOTSTD_HAS_CONSTEXPR_VECTOR
+            return std::is_constant_evaluated();
+#else
+            return false;
+#endif
+        }
+
+        template <typename T, typename... Args>
+        NOTSTD_CONSTEXPR T* ConstructAt(T* location, Args&&... args) {
+#if NOTSTD_HAS_CONSTEXPR_VECTOR
+            return std::construct_at(location, std::forward<Args>(args)...);
+#else
+            return new (location) T(std::forward<Args>(args)...);
+#endif
+        }
+
+        // The std::uninitialized_* algorithms are not constexpr, so constant evaluation
+        // takes a plain construct_at loop; exceptions there are compile errors anyway.
+        template <typename T>
+        NOTSTD_CONSTEXPR void UninitializedValueConstructN(T* to, size_t size) {
+            if (IsConstantEvaluated()) {
+                for (size_t i = 0; i < size; ++i) {
+                    ConstructAt(to + i);
+                }
+            } else {
+                std::uninitialized_value_construct_n(to, size);
+            }
+        }
+
+        template <typename It, typename T>
+        NOTSTD_CONSTEXPR void UninitializedCopyN(It from, size_t size, T* to) {
+            if (IsConstantEvaluated()) {
+                for (size_t i = 0; i < size; ++i, ++from) {
+                    ConstructAt(to + i, *from);
+                }
+            } else {
+                std::uninitialized_copy_n(from, size, to);
+            }
+        }
+
+        // Trivial values whose bytes are a repeated single byte (always for 1-byte types,
+        // and all-zero values of any size) are written with memset
+        template <typename T>
+        bool FillByMemset(const T& value, unsigned char& byte) noexcept {
+            if constexpr (!std::is_trivially_copyable_v<T>) {
+                return false;
+            } else {
+                unsigned char bytes[sizeof(T)];
+                std::memcpy(bytes, &value, sizeof(T));
+                byte = bytes[0];
+                if constexpr (sizeof(T) == 1) {
+                    return true;
+                } else {
+                    for (unsigned char b : bytes) {
+                        if (b != 0) {
+                            return false;
+                        }
+                    }
+                    return true;
+                }
+            }
+        }
+
+        template <typename T>
+        NOTSTD_CONSTEXPR void FillN(T* to, size_t size, const T& value) {
+            unsigned char byte = 0;
+            if (!IsConstantEvaluated() && size != 0 && FillByMemset(value, byte)) {
+                std::memset(static_cast<void*>(to), byte, size * sizeof(T));
+            } else {
+                std::fill_n(to, size, value);
+            }
+        }
+
+        template <typename T>
+        NOTSTD_CONSTEXPR void UninitializedFillN(T* to, size_t size, const T& value) {
+            unsigned char byte = 0;
+            if (IsConstantEvaluated()) {
+                for (size_t i = 0; i < size; ++i) {
+                    ConstructAt(to + i, value);
+                }
+            } else if (size != 0 && FillByMemset(value, byte)) {
+                std::memset(static_cast<void*>(to), byte, size * sizeof(T));
+            } else {
+                std::uninitialized_fill_n(to, size, value);
+            }
+        }
+
+        template <typename T>
+        NOTSTD_CONSTEXPR void UninitializedMoveN(T* from, size_t size, T* to) {
+            if (IsConstantEvaluated()) {
+                for (size_t i = 0; i < size; ++i) {
+                    ConstructAt(to + i, std::move(from[i]));
+                }
+            } else {
+                std::uninitialized_move_n(from, size, to);
+            }
+        }
+    }//namespace detail
+
+    template <typename E>
+    class VectorExpression;
+
+    class SharedBuffer;
+
     template <typename T>
     class RawMemory {
     public:
         RawMemory() = default;
 
-        explicit RawMemory(size_t capacity)
-            : buffer_(Allocate(capacity))
+        // Charged to MemoryBudget::Current(), if any, before the memory is requested
+        NOTSTD_CONSTEXPR explicit RawMemory(size_t capacity)
+            : RawMemory(capacity, !NOTSTD_MEMORY_BUDGET || detail::IsConstantEvaluated() ? nullptr : MemoryBudget::Current()) {
+        }
+
+        // Charged to budget instead of the current one
+        NOTSTD_CONSTEXPR RawMemory(size_t capacity, [[maybe_unused]] MemoryBudget* budget)
+#if NOTSTD_MEMORY_BUDGET
+            : budget_(capacity != 0 && !detail::IsConstantEvaluated() ? budget : nullptr)
+            , buffer_(Allocate(capacity, budget_))
+#else
+            : buffer_(Allocate(capacity, nullptr))
+#endif
             , capacity_(capacity) {
         }
 
         RawMemory(const RawMemory&) = delete;
         RawMemory& operator=(const RawMemory& rhs) = delete;
 
-        RawMemory(RawMemory&& other) noexcept
+        NOTSTD_CONSTEXPR RawMemory(RawMemory&& other) noexcept
             : buffer_(std::move(other.buffer_))
             , capacity_(std::move(other.capacity_)) {
+#if NOTSTD_MEMORY_BUDGET
+            budget_ = std::exchange(other.budget_, nullptr);
+#endif
             other.buffer_ = nullptr;
             other.capacity_ = 0;
+#if NOTSTD_HARDENED
+            ++other.generation_;
+#endif
         }
 
-        ~RawMemory() {
-            Deallocate(buffer_);
+        NOTSTD_CONSTEXPR ~RawMemory() {
+            Deallocate(buffer_, capacity_, Budget());
         }    
 
-        RawMemory& operator=(RawMemory&& rhs) noexcept {
-            Deallocate(buffer_);
+        NOTSTD_CONSTEXPR RawMemory& operator=(RawMemory&& rhs) noexcept {
+            Deallocate(buffer_, capacity_, Budget());
+#if NOTSTD_MEMORY_BUDGET
+            budget_ = std::exchange(rhs.budget_, nullptr);
+#endif
             buffer_ = std::move(rhs.buffer_);
             capacity_ = rhs.capacity_;
             rhs.buffer_ = nullptr;
             rhs.capacity_ = 0;
+#if NOTSTD_HARDENED
+            ++generation_;
+            ++rhs.generation_;
+#endif
             return *this;
         }
 
-        T* operator+(size_t offset) noexcept {
+        NOTSTD_CONSTEXPR T* operator+(size_t offset) noexcept {
             return buffer_ + offset;
         }
 
-        const T* operator+(size_t offset) const noexcept {
+        NOTSTD_CONSTEXPR const T* operator+(size_t offset) const noexcept {
             return const_cast<RawMemory&>(*this) + offset;
         }
 
-        const T& operator[](size_t index) const noexcept {
+        NOTSTD_CONSTEXPR const T& operator[](size_t index) const noexcept {
             return const_cast<RawMemory&>(*this)[index];
         }
 
-        T& operator[](size_t index) noexcept {
+        NOTSTD_CONSTEXPR T& operator[](size_t index) noexcept {
+#if NOTSTD_HARDENED
+            if (index >= capacity_) {
+                detail::HardeningFailure("RawMemory index out of range");
+            }
+#endif
             assert(index < capacity_);
             return buffer_[index];
         }
 
-        void Swap(RawMemory& other) noexcept {
+        NOTSTD_CONSTEXPR void Swap(RawMemory& other) noexcept {
+#if NOTSTD_MEMORY_BUDGET
+            std::swap(budget_, other.budget_);
+#endif
             std::swap(buffer_, other.buffer_);
             std::swap(capacity_, other.capacity_);
+#if NOTSTD_HARDENED
+            ++generation_;
+            ++other.generation_;
+#endif
         }
 
-        const T* GetAddress() const noexcept {
+#if NOTSTD_HARDENED
+        // Changes whenever this object's buffer is swapped or moved away
+        NOTSTD_CONSTEXPR size_t Generation() const noexcept {
+            return generation_;
+        }
+#endif
+
+        NOTSTD_CONSTEXPR const T* GetAddress() const noexcept {
             return buffer_;
         }
 
-        T* GetAddress() noexcept {
+        NOTSTD_CONSTEXPR T* GetAddress() noexcept {
             return buffer_;
         }
 
-        size_t Capacity() const {
+        NOTSTD_CONSTEXPR size_t Capacity() const {
             return capacity_;
         }
 
+        // The budget this buffer is charged to; always nullptr unless NOTSTD_MEMORY_BUDGET is set
+        NOTSTD_CONSTEXPR MemoryBudget* Budget() const noexcept {
+#if NOTSTD_MEMORY_BUDGET
+            return budget_;
+#else
+            return nullptr;
+#endif
+        }
+
+        // A buffer of capacity elements to grow or shrink into, charged to the same budget as
+        // this one, so a container keeps its budget when it reallocates outside the scope it
+        // was created in. Only when there is no buffer yet is MemoryBudget::Current() charged.
+        NOTSTD_CONSTEXPR RawMemory Replacement(size_t capacity) const {
+            if (capacity_ != 0) {
+                return RawMemory(capacity, Budget());
+            }
+            return RawMemory(capacity);
+        }
+
+        // Takes ownership of a buffer of capacity elements that came from Release() (or the
+        // same operator new RawMemory uses), charging it to budget
+        static RawMemory Adopt(T* buffer, size_t capacity, [[maybe_unused]] MemoryBudget* budget) {
+            assert((buffer == nullptr) == (capacity == 0));
+            assert(reinterpret_cast<uintptr_t>(buffer) % alignof(T) == 0);
+#if defined(NOTSTD_HAS_ASAN)
+            if (buffer != nullptr && (!__sanitizer_get_ownership(buffer)
+                                      || __sanitizer_get_allocated_size(buffer) < capacity * sizeof(T))) {
+                detail::HardeningFailure("adopted buffer is not a heap allocation of the given capacity");
+            }
+#endif
+            RawMemory result;
+#if NOTSTD_MEMORY_BUDGET
+            if (capacity != 0 && budget != nullptr) {
+                budget->Charge(capacity * sizeof(T));
+                result.budget_ = budget;
+            }
+#endif
+            result.buffer_ = buffer;
+            result.capacity_ = capacity;
+            return result;
+        }
+
+        // Gives up the buffer without freeing it; it no longer counts against the budget
+        T* Release() noexcept {
+#if NOTSTD_MEMORY_BUDGET
+            if (budget_ != nullptr) {
+                budget_->Release(capacity_ * sizeof(T));
+            }
+            budget_ = nullptr;
+#endif
+            capacity_ = 0;
+#if NOTSTD_HARDENED
+            ++generation_;
+#endif
+            return std::exchange(buffer_, nullptr);
+        }
+
+        // Views the whole allocation, including the uninitialized tail
+        NOTSTD_CONSTEXPR Span<T> AsSpan() noexcept {
+            return Span<T>(buffer_, capacity_);
+        }
+
+        NOTSTD_CONSTEXPR Span<const T> AsSpan() const noexcept {
+            return Span<const T>(buffer_, capacity_);
+        }
+
     private:
-        static T* Allocate(size_t n) {
-            return n != 0 ? static_cast<T*>(operator new(n * sizeof(T))) : nullptr;
+        static NOTSTD_CONSTEXPR T* Allocate(size_t n, MemoryBudget* budget) {
+            if (n == 0) {
+                return nullptr;
+            }
+            if (detail::IsConstantEvaluated()) {
+                return std::allocator<T>().allocate(n);
+            }
+            if (budget != nullptr) {
+                budget->Charge(n * sizeof(T));
+            }
+            try {
+                if constexpr (alignof(T) > __STDCPP_DEFAULT_NEW_ALIGNMENT__) {
+                    return static_cast<T*>(operator new(n * sizeof(T), std::align_val_t(alignof(T))));
+                } else {
+                    return static_cast<T*>(operator new(n * sizeof(T)));
+                }
+            } catch (...) {
+                if (budget != nullptr) {
+                    budget->Release(n * sizeof(T));
+                }
+                throw;
+            }
         }
 
-        static void Deallocate(T* buf) noexcept {
-            operator delete(buf);
+        static NOTSTD_CONSTEXPR void Deallocate(T* buf, size_t n, MemoryBudget* budget) noexcept {
+            if (detail::IsConstantEvaluated()) {
+                if (buf != nullptr) {
+                    std::allocator<T>().deallocate(buf, n);
+                }
+                return;
+            }
+            if (budget != nullptr) {
+                budget->Release(n * sizeof(T));
+            }
+            if constexpr (alignof(T) > __STDCPP_DEFAULT_NEW_ALIGNMENT__) {
+                operator delete(buf, std::align_val_t(alignof(T)));
+            } else {
+                operator delete(buf);
+            }
         }
 
     private:
+#if NOTSTD_MEMORY_BUDGET
+        MemoryBudget* budget_ = nullptr;
+#endif
         T* buffer_ = nullptr;
         size_t capacity_ = 0;
+#if NOTSTD_HARDENED
+        size_t generation_ = 0;
+#endif
+    };
+
+    // Storage taken out of a Vector by Release(). Give it back with Vector::Adopt or free it
+    // with DeleteReleased; nothing else knows how it was allocated.
+    template <typename T>
+    struct ReleasedBuffer {
+        T* data = nullptr;
+        size_t size = 0;
+        size_t capacity = 0;
     };
 
     template <typename T>
@@ -93,145 +375,244 @@ namespace notstd {
     public:
         Vector() = default;
 
-        explicit Vector(size_t size)
+        NOTSTD_CONSTEXPR explicit Vector(size_t size)
             : data_(size)
             , size_(size) {
-            std::uninitialized_value_construct_n(begin(), size);
+            detail::UninitializedValueConstructN(Data(), size);
         }
 
-        Vector(const Vector& other)
+        NOTSTD_CONSTEXPR Vector(const Vector& other)
             : data_(other.size_)
             , size_(other.size_) {
-            std::uninitialized_copy_n(other.begin(), size_, begin());
+            detail::UninitializedCopyN(other.Data(), size_, Data());
         }
 
-        Vector(Vector&& other)  noexcept
+        NOTSTD_CONSTEXPR Vector(Vector&& other)  noexcept
             : data_(std::move(other.data_))
             , size_(std::move(other.size_)) {
             other.size_ = 0;
         }
 
+        // Evaluates an elementwise expression (see vector_expr.h) in a single pass
+        template <typename E>
+        Vector(const VectorExpression<E>& expr)
+            : data_(expr.Size())
+            , size_(expr.Size()) {
+            static_assert(std::is_trivially_destructible_v<T>, "expressions are only defined for arithmetic vectors");
+            expr.EvaluateTo(data_.GetAddress());
+        }
+
+#if NOTSTD_HARDENED
+        using iterator = detail::CheckedIterator<T, Vector>;
+        using const_iterator = detail::CheckedIterator<const T, Vector>;
+#else
         using iterator = T*;
         using const_iterator = const T*;
+#endif
 
-        iterator begin() noexcept {
-            return data_.GetAddress();
+        NOTSTD_CONSTEXPR iterator begin() noexcept {
+            return MakeIterator(data_.GetAddress());
         }
 
-        iterator end() noexcept {
-            return data_.GetAddress() + size_;
+        NOTSTD_CONSTEXPR iterator end() noexcept {
+            return MakeIterator(data_.GetAddress() + size_);
         }
 
-        const_iterator begin() const noexcept {
-            return data_.GetAddress();
+        NOTSTD_CONSTEXPR const_iterator begin() const noexcept {
+            return const_cast<Vector&>(*this).begin();
         }
 
-        const_iterator end() const noexcept {
-            return data_.GetAddress() + size_;
+        NOTSTD_CONSTEXPR const_iterator end() const noexcept {
+            return const_cast<Vector&>(*this).end();
         }
 
-        const_iterator cbegin() const noexcept {
-            return data_.GetAddress();
+        NOTSTD_CONSTEXPR const_iterator cbegin() const noexcept {
+            return begin();
         }
 
-        const_iterator cend() const noexcept {
-            return data_.GetAddress() + size_;
+        NOTSTD_CONSTEXPR const_iterator cend() const noexcept {
+            return end();
         }
 
         template <typename... Args>
-        T& EmplaceBack(Args&&... args) {
+        NOTSTD_CONSTEXPR T& EmplaceBack(Args&&... args) {
             if (size_ < data_.Capacity()) {
-                new (data_ + size_) T(std::forward<Args>(args)...);
+                Annotate(data_, size_, size_ + 1);
+                detail::ConstructAt(data_ + size_, std::forward<Args>(args)...);
                 ++size_;
             } else {
                 size_t new_capacity = size_ == 0 ? 1 : size_ * 2;
-                RawMemory<T> new_data(new_capacity);
-                new (new_data + size_) T(std::forward<Args>(args)...);
-                UninitializedMoveOrCopy(begin(), size_, new_data.GetAddress());
-                std::destroy_n(begin(), size_);
-                data_.Swap(new_data);
-                ++size_;
+                RawMemory<T> new_data = data_.Replacement(new_capacity);
+                detail::ConstructAt(new_data + size_, std::forward<Args>(args)...);
+                UninitializedMoveOrCopy(Data(), size_, new_data.GetAddress());
+                std::destroy_n(Data(), size_);
+                ReplaceStorage(new_data, size_ + 1);
             }
             return data_[size_ - 1];
         }
         
         template <typename V>
-        void PushBack(V&& value) {
+        NOTSTD_CONSTEXPR void PushBack(V&& value) {
             EmplaceBack(std::forward<V>(value));
         }
 
         template <typename... Args>
-        iterator Emplace(const_iterator pos, Args&&... args) {
-            assert(pos >= begin() && pos <= end());
-            size_t before = pos - begin();
-            size_t after = end() - pos - 1;
-            if (pos == end()) {
+        NOTSTD_CONSTEXPR iterator Emplace(const_iterator it, Args&&... args) {
+            T* pos = ToPointer(it);
+            assert(pos >= Data() && pos <= Data() + size_);
+            size_t before = pos - Data();
+            size_t after = Data() + size_ - pos - 1;
+            if (pos == Data() + size_) {
                 EmplaceBack(std::forward<Args>(args)...);
             } else if (size_ < data_.Capacity()) {
                 T tmp = T(std::forward<Args>(args)...);
-                new (data_ + size_) T(std::forward<T>(*(end() - 1)));
-                std::move_backward(const_cast<iterator>(pos), end() - 1, end());
+                Annotate(data_, size_, size_ + 1);
+                detail::ConstructAt(data_ + size_, std::forward<T>(data_[size_ - 1]));
+                std::move_backward(pos, Data() + size_ - 1, Data() + size_);
                 data_[before] = std::move(tmp);
                 ++size_;
             } else {
                 size_t new_capacity = size_ == 0 ? 1 : size_ * 2;
-                RawMemory<T> new_data(new_capacity);
-                new (new_data + before) T(std::forward<Args>(args)...);
+                RawMemory<T> new_data = data_.Replacement(new_capacity);
+                detail::ConstructAt(new_data + before, std::forward<Args>(args)...);
                 
                 try {
-                    UninitializedMoveOrCopy(begin(), before, new_data.GetAddress());
+                    UninitializedMoveOrCopy(Data(), before, new_data.GetAddress());
                 }
                 catch (...) {
-                    (new_data + size_)->~T();
+                    std::destroy_at(new_data + before);
                     throw;
                 }
 
                 try {
-                    UninitializedMoveOrCopy(const_cast<iterator>(pos), after + 1, new_data.GetAddress() + (before + 1));
+                    UninitializedMoveOrCopy(pos, after + 1, new_data.GetAddress() + (before + 1));
                 }
                 catch (...) {
                     std::destroy_n(new_data.GetAddress(), before);
                     throw;
                 }
 
-                std::destroy_n(begin(), size_);
-                data_.Swap(new_data);
-                ++size_;
+                std::destroy_n(Data(), size_);
+                ReplaceStorage(new_data, size_ + 1);
             }
-            return data_.GetAddress() + before;
+            return MakeIterator(data_.GetAddress() + before);
         }
             
         template <typename V>
-        iterator Insert(const_iterator pos, V&& value) {
+        NOTSTD_CONSTEXPR iterator Insert(const_iterator pos, V&& value) {
             return Emplace(pos, std::forward<V>(value));
         }
 
-        void PopBack() noexcept {
-            std::destroy_n(begin() + (size_ - 1), 1);
+        NOTSTD_CONSTEXPR void PopBack() noexcept {
+            std::destroy_at(Data() + size_ - 1);
             --size_;
+            Annotate(data_, size_ + 1, size_);
         }
 
-        iterator Erase(const_iterator pos) {
-            assert(pos >= begin() && pos < end());
-            std::move(const_cast<iterator>(pos) + 1, end(), const_cast<iterator>(pos));
-            (end() - 1)->~T();
+        NOTSTD_CONSTEXPR iterator Erase(const_iterator it) {
+            T* pos = ToPointer(it);
+            assert(pos >= Data() && pos < Data() + size_);
+            std::move(pos + 1, Data() + size_, pos);
+            std::destroy_at(Data() + size_ - 1);
             --size_;
-            return const_cast<iterator>(pos);
+            Annotate(data_, size_ + 1, size_);
+            return MakeIterator(pos);
         }    
 
-        Vector& operator=(const Vector& rhs) {
+        // Inserts value after any equal elements, keeping a vector sorted by comp sorted
+        template <typename V, typename Compare = std::less<>>
+        NOTSTD_CONSTEXPR iterator InsertSorted(V&& value, Compare comp = {}) {
+            T* pos = std::upper_bound(Data(), Data() + size_, value, comp);
+            return Emplace(MakeIterator(pos), std::forward<V>(value));
+        }
+
+        // Merges copies of a sorted range into this sorted vector in O(Size() + other.Size()).
+        // The merge runs back to front inside the existing buffer, growing it at most once.
+        // Equal elements already in the vector stay ahead of the merged ones. If copying an
+        // element throws, the vector holds valid but unspecified values.
+        template <typename Compare = std::less<>>
+        NOTSTD_CONSTEXPR void MergeSorted(Span<const T> other, Compare comp = {}) {
+            if (other.Empty()) {
+                return;
+            }
+            if (Overlaps(other)) {
+                Vector copy;
+                copy.Reserve(other.Size());
+                for (const T& item : other) {
+                    copy.EmplaceBack(item);
+                }
+                MergeSorted(copy.AsSpan(), comp);
+                return;
+            }
+            const size_t new_size = size_ + other.Size();
+            if (new_size > data_.Capacity()) {
+                Reserve(std::max(new_size, size_ * 2));
+            }
+            Annotate(data_, size_, new_size);
+
+            T* data = Data();
+            size_t i = size_;
+            size_t j = other.Size();
+            size_t out = new_size;
+            // slots [tail, new_size) past the old end have been constructed
+            size_t tail = new_size;
+            try {
+                while (j > 0) {
+                    --out;
+                    bool take_own = i > 0 && comp(other[j - 1], data[i - 1]);
+                    if (out >= size_) {
+                        if (take_own) {
+                            detail::ConstructAt(data + out, std::move(data[--i]));
+                        } else {
+                            detail::ConstructAt(data + out, other[--j]);
+                        }
+                        tail = out;
+                    } else if (take_own) {
+                        data[out] = std::move(data[--i]);
+                    } else {
+                        data[out] = other[--j];
+                    }
+                }
+            } catch (...) {
+                if (tail > size_) {
+                    std::destroy_n(data + tail, new_size - tail);
+                    Annotate(data_, new_size, size_);
+                } else {
+                    size_ = new_size;
+                }
+                throw;
+            }
+            size_ = new_size;
+        }
+
+        // Removes consecutive duplicates, leaving a sorted vector with unique elements.
+        // Returns the number of elements removed.
+        template <typename Equal = std::equal_to<>>
+        NOTSTD_CONSTEXPR size_t Dedup(Equal equal = {}) {
+            T* new_end = std::unique(Data(), Data() + size_, equal);
+            size_t new_size = new_end - Data();
+            size_t removed = size_ - new_size;
+            std::destroy_n(new_end, removed);
+            Annotate(data_, size_, new_size);
+            size_ = new_size;
+            return removed;
+        }
+
+        NOTSTD_CONSTEXPR Vector& operator=(const Vector& rhs) {
             if (this != &rhs) {
                 if (rhs.size_ > data_.Capacity()) {
                     Vector rhs_copy(rhs);
                     Swap(rhs_copy);
                 } else {
                     if (rhs.size_ < size_) {
-                        std::copy(rhs.begin(), rhs.begin() + rhs.size_, begin());
-                        std::destroy_n(begin() + rhs.size_, size_ - rhs.size_);
+                        std::copy(rhs.Data(), rhs.Data() + rhs.size_, Data());
+                        std::destroy_n(Data() + rhs.size_, size_ - rhs.size_);
+                        Annotate(data_, size_, rhs.size_);
                         size_ = rhs.size_;
                     } else {
-                        std::copy(rhs.begin(), rhs.begin() + size_, begin());
-                        std::uninitialized_copy_n(rhs.begin() + size_, rhs.size_ - size_, end());
+                        std::copy(rhs.Data(), rhs.Data() + size_, Data());
+                        Annotate(data_, size_, rhs.size_);
+                        detail::UninitializedCopyN(rhs.Data() + size_, rhs.size_ - size_, Data() + size_);
                         size_ = rhs.size_;
                     }
                 }
@@ -239,70 +620,363 @@ namespace notstd {
             return *this;
         }
 
-        Vector& operator=(Vector&& rhs) noexcept {
+        template <typename E>
+        Vector& operator=(const VectorExpression<E>& expr) {
+            static_assert(std::is_trivially_destructible_v<T>, "expressions are only defined for arithmetic vectors");
+            size_t new_size = expr.Size();
+            if (new_size > data_.Capacity()) {
+                // the expression may still read from this vector, so keep it alive until evaluated
+                RawMemory<T> new_data = data_.Replacement(new_size);
+                expr.EvaluateTo(new_data.GetAddress());
+                ReplaceStorage(new_data, new_size);
+            } else {
+                if (new_size > size_) {
+                    Annotate(data_, size_, new_size);
+                }
+                expr.EvaluateTo(data_.GetAddress());
+                if (new_size < size_) {
+                    Annotate(data_, size_, new_size);
+                }
+                size_ = new_size;
+            }
+            return *this;
+        }
+
+        NOTSTD_CONSTEXPR Vector& operator=(Vector&& rhs) noexcept {
             if (this != &rhs) {
+                std::destroy_n(Data(), size_);
+                Annotate(data_, size_, 0);
+                size_ = 0;
                 Swap(rhs);
-                rhs.size_ = 0;
             }
             return *this;
         }
 
-        void Swap(Vector& other) noexcept {
+        NOTSTD_CONSTEXPR void Swap(Vector& other) noexcept {
             data_.Swap(other.data_);
             std::swap(size_, other.size_);
         }
 
-        void Reserve(size_t new_capacity) {
+        NOTSTD_CONSTEXPR void Reserve(size_t new_capacity) {
             if (new_capacity <= data_.Capacity()) {
                 return;
             }
-            RawMemory<T> new_data(new_capacity);
-            UninitializedMoveOrCopy(begin(), size_, new_data.GetAddress());
-            std::destroy_n(begin(), size_);
-            data_.Swap(new_data);
+            RawMemory<T> new_data = data_.Replacement(new_capacity);
+            UninitializedMoveOrCopy(Data(), size_, new_data.GetAddress());
+            std::destroy_n(Data(), size_);
+            ReplaceStorage(new_data, size_);
+        }
+
+        // Destroys the elements but keeps the allocation for reuse
+        NOTSTD_CONSTEXPR void Clear() noexcept {
+            std::destroy_n(Data(), size_);
+            Annotate(data_, size_, 0);
+            size_ = 0;
+        }
+
+        // Replaces the contents with count copies of value, which may be one of the elements.
+        // Reuses the allocation when it is large enough.
+        NOTSTD_CONSTEXPR void Assign(size_t count, const T& value) {
+            if (count > data_.Capacity()) {
+                Vector fresh;
+                fresh.data_ = data_.Replacement(count);
+                detail::UninitializedFillN(fresh.Data(), count, value);
+                fresh.size_ = count;
+                Swap(fresh);
+                return;
+            }
+            detail::FillN(Data(), std::min(count, size_), value);
+            if (count > size_) {
+                Annotate(data_, size_, count);
+                detail::UninitializedFillN(Data() + size_, count - size_, value);
+            } else {
+                std::destroy_n(Data() + count, size_ - count);
+                Annotate(data_, size_, count);
+            }
+            size_ = count;
+        }
+
+        // Replaces the contents with [first, last), which may be a range of this vector.
+        // Forward ranges are copied in one pass into reused or exact-size storage.
+        template <typename It, typename Category = typename std::iterator_traits<It>::iterator_category>
+        NOTSTD_CONSTEXPR void Assign(It first, It last) {
+            if constexpr (!std::is_base_of_v<std::forward_iterator_tag, Category>) {
+                Clear();
+                for (; first != last; ++first) {
+                    EmplaceBack(*first);
+                }
+            } else {
+                size_t count = static_cast<size_t>(std::distance(first, last));
+                if (count > data_.Capacity()) {
+                    Vector fresh;
+                    fresh.data_ = data_.Replacement(count);
+                    detail::UninitializedCopyN(first, count, fresh.Data());
+                    fresh.size_ = count;
+                    Swap(fresh);
+                    return;
+                }
+                // a source inside this vector starts at or after Data(), so copying forward
+                // over the live elements never overwrites what is still to be read
+                size_t common = std::min(count, size_);
+                It rest = std::next(first, common);
+                std::copy(first, rest, Data());
+                if (count > size_) {
+                    Annotate(data_, size_, count);
+                    detail::UninitializedCopyN(rest, count - size_, Data() + size_);
+                } else {
+                    std::destroy_n(Data() + count, size_ - count);
+                    Annotate(data_, size_, count);
+                }
+                size_ = count;
+            }
+        }
+
+        // Sets every element to value
+        NOTSTD_CONSTEXPR void Fill(const T& value) {
+            detail::FillN(Data(), size_, value);
+        }
+
+        // Releases unused capacity by moving the elements into an exact-size allocation
+        NOTSTD_CONSTEXPR void ShrinkToFit() {
+            if (data_.Capacity() != size_) {
+                Relocate();
+            }
         }
 
-        void Resize(size_t new_size) {
+        // Moves the elements into a fresh exact-size allocation, even when there is no spare
+        // capacity, so long-lived data can be packed together after the heap has fragmented.
+        // The new allocation is charged to the same budget as the old one.
+        NOTSTD_CONSTEXPR void Relocate() {
+            RawMemory<T> new_data = data_.Replacement(size_);
+            UninitializedMoveOrCopy(Data(), size_, new_data.GetAddress());
+            std::destroy_n(Data(), size_);
+            ReplaceStorage(new_data, size_);
+        }
+
+        NOTSTD_CONSTEXPR void Resize(size_t new_size) {
             if (new_size == size_) {
                 return;
             }
             if (new_size < size_) {
-                std::destroy_n(begin() + new_size, size_ - new_size);
+                std::destroy_n(Data() + new_size, size_ - new_size);
+                Annotate(data_, size_, new_size);
                 size_ = new_size;
             } else {
                 Reserve(new_size);
-                std::uninitialized_value_construct_n(end(), new_size - size_);
+                Annotate(data_, size_, new_size);
+                detail::UninitializedValueConstructN(Data() + size_, new_size - size_);
                 size_ = new_size;
             }
         }
 
-        size_t Size() const noexcept {
+        // Uninitialized storage between Size() and Capacity(). Trivially copyable elements
+        // written there (e.g. by read(2)) become part of the vector after CommitAppend.
+        NOTSTD_CONSTEXPR Span<T> SpareCapacity() noexcept {
+            Annotate(data_, size_, data_.Capacity());
+            return Span<T>(data_.GetAddress() + size_, data_.Capacity() - size_);
+        }
+
+        NOTSTD_CONSTEXPR void CommitAppend(size_t count) noexcept {
+            static_assert(std::is_trivially_copyable_v<T>, "only trivially copyable elements can be appended in place");
+            assert(count <= data_.Capacity() - size_);
+            size_ += count;
+            Annotate(data_, data_.Capacity(), size_);
+        }
+
+        NOTSTD_CONSTEXPR size_t Size() const noexcept {
             return size_;
         }
 
-        size_t Capacity() const noexcept {
+        NOTSTD_CONSTEXPR size_t Capacity() const noexcept {
             return data_.Capacity();
         }
 
-        const T& operator[](size_t index) const noexcept {
+        NOTSTD_CONSTEXPR const T& operator[](size_t index) const noexcept {
             return const_cast<Vector&>(*this)[index];
         }
 
-        T& operator[](size_t index) noexcept {
+        NOTSTD_CONSTEXPR T& operator[](size_t index) noexcept {
+#if NOTSTD_HARDENED
+            if (index >= size_) {
+                detail::HardeningFailure("Vector index out of range");
+            }
+#endif
             assert(index < size_);
             return data_[index];
         }
 
-        ~Vector() {
-            std::destroy_n(begin(), size_);
+        NOTSTD_CONSTEXPR const T& At(size_t index) const {
+            return const_cast<Vector&>(*this).At(index);
+        }
+
+        NOTSTD_CONSTEXPR T& At(size_t index) {
+            if (index >= size_) {
+                throw std::out_of_range("notstd::Vector::At: index out of range");
+            }
+            return data_[index];
+        }
+
+        NOTSTD_CONSTEXPR T* Data() noexcept {
+            return data_.GetAddress();
+        }
+
+        NOTSTD_CONSTEXPR const T* Data() const noexcept {
+            return data_.GetAddress();
+        }
+
+        NOTSTD_CONSTEXPR Span<T> AsSpan() noexcept {
+            return Span<T>(data_.GetAddress(), size_);
+        }
+
+        NOTSTD_CONSTEXPR Span<const T> AsSpan() const noexcept {
+            return Span<const T>(data_.GetAddress(), size_);
+        }
+
+        NOTSTD_CONSTEXPR operator Span<T>() noexcept {
+            return AsSpan();
+        }
+
+        NOTSTD_CONSTEXPR operator Span<const T>() const noexcept {
+            return AsSpan();
+        }
+
+        NOTSTD_CONSTEXPR Span<T> Subspan(size_t offset, size_t count = dynamic_extent) noexcept {
+            return AsSpan().Subspan(offset, count);
+        }
+
+        NOTSTD_CONSTEXPR Span<const T> Subspan(size_t offset, size_t count = dynamic_extent) const noexcept {
+            return AsSpan().Subspan(offset, count);
+        }
+
+        NOTSTD_CONSTEXPR Span<T> First(size_t count) noexcept {
+            return AsSpan().First(count);
+        }
+
+        NOTSTD_CONSTEXPR Span<const T> First(size_t count) const noexcept {
+            return AsSpan().First(count);
+        }
+
+        NOTSTD_CONSTEXPR Span<T> Last(size_t count) noexcept {
+            return AsSpan().Last(count);
+        }
+
+        NOTSTD_CONSTEXPR Span<const T> Last(size_t count) const noexcept {
+            return AsSpan().Last(count);
         }
 
+        NOTSTD_CONSTEXPR StridedSpan<T> Strided(size_t stride) noexcept {
+            return AsSpan().Strided(stride);
+        }
+
+        NOTSTD_CONSTEXPR StridedSpan<const T> Strided(size_t stride) const noexcept {
+            return AsSpan().Strided(stride);
+        }
+
+        // Gives up the buffer with its elements still alive and leaves the vector empty.
+        // The spare capacity is unpoisoned for ASan so the new owner may write to it.
+        ReleasedBuffer<T> Release() noexcept {
+            Annotate(data_, size_, data_.Capacity());
+            ReleasedBuffer<T> released{data_.GetAddress(), size_, data_.Capacity()};
+            data_.Release();
+            size_ = 0;
+            return released;
+        }
+
+        // Builds a vector around storage from Release(), with its first size elements alive.
+        // The allocation is charged to MemoryBudget::Current(); if that throws, the caller
+        // still owns the buffer.
+        static Vector Adopt(T* data, size_t size, size_t capacity) {
+#if NOTSTD_HARDENED
+            if (size > capacity) {
+                detail::HardeningFailure("adopted size exceeds capacity");
+            }
+#endif
+            assert(size <= capacity);
+            Vector result;
+            result.data_ = RawMemory<T>::Adopt(data, capacity, MemoryBudget::Current());
+            result.size_ = size;
+            Annotate(result.data_, capacity, size);
+            return result;
+        }
+
+        static Vector Adopt(const ReleasedBuffer<T>& buffer) {
+            return Adopt(buffer.data, buffer.size, buffer.capacity);
+        }
+
+        // Defined in shared_buffer.h; a free function so that only Vector<std::byte> has it
+        friend SharedBuffer ReleaseToShared(Vector<std::byte>&& vector);
+
+        NOTSTD_CONSTEXPR ~Vector() {
+            std::destroy_n(Data(), size_);
+            Annotate(data_, size_, data_.Capacity());
+        }
+
+#if NOTSTD_HARDENED
+        NOTSTD_CONSTEXPR size_t Generation() const noexcept {
+            return data_.Generation();
+        }
+#endif
+
     private:
-        void UninitializedMoveOrCopy(iterator from, size_t size, iterator to) {
+        NOTSTD_CONSTEXPR iterator MakeIterator(T* ptr) noexcept {
+#if NOTSTD_HARDENED
+            return iterator(ptr, this, data_.Generation());
+#else
+            return ptr;
+#endif
+        }
+
+        NOTSTD_CONSTEXPR T* ToPointer(const_iterator it) noexcept {
+#if NOTSTD_HARDENED
+            return const_cast<T*>(it.CheckedBase(this));
+#else
+            return const_cast<T*>(it);
+#endif
+        }
+
+        // Installs new_data, already holding new_size constructed elements, as the storage.
+        // ASan needs the outgoing buffer fully unpoisoned before it is freed.
+        NOTSTD_CONSTEXPR void ReplaceStorage(RawMemory<T>& new_data, size_t new_size) noexcept {
+            Annotate(data_, size_, data_.Capacity());
+            data_.Swap(new_data);
+            size_ = new_size;
+            Annotate(data_, data_.Capacity(), size_);
+        }
+
+        // Moves the boundary between live elements and the poisoned tail of buffer
+        static NOTSTD_CONSTEXPR void Annotate(const RawMemory<T>& buffer, size_t old_size, size_t new_size) noexcept {
+#if NOTSTD_ANNOTATE_CONTAINERS
+            if (detail::IsConstantEvaluated() || buffer.Capacity() == 0 || old_size == new_size) {
+                return;
+            }
+            const T* begin = buffer.GetAddress();
+            __sanitizer_annotate_contiguous_container(begin, begin + buffer.Capacity(), begin + old_size, begin + new_size);
+#else
+            (void)buffer, (void)old_size, (void)new_size;
+#endif
+        }
+
+        NOTSTD_CONSTEXPR bool Overlaps(Span<const T> range) const noexcept {
+            if (detail::IsConstantEvaluated()) {
+                // ordering unrelated pointers is not a constant expression, but equality is
+                for (size_t i = 0; i < size_; ++i) {
+                    if (Data() + i == range.Data()) {
+                        return true;
+                    }
+                }
+                return false;
+            }
+            std::less<const T*> less;
+            return less(range.Data(), Data() + size_) && less(Data(), range.Data() + range.Size());
+        }
+
+        NOTSTD_CONSTEXPR void UninitializedMoveOrCopy(T* from, size_t size, T* to) {
+            static_assert(std::is_move_constructible_v<T> || std::is_copy_constructible_v<T>,
+                          "Vector relocates its elements; use SegmentedVector for non-movable types");
             if constexpr (std::is_nothrow_move_constructible_v<T> || !std::is_copy_constructible_v<T>) {
-                std::uninitialized_move_n(from, size, to);
+                detail::UninitializedMoveN(from, size, to);
             } else {
-                std::uninitialized_copy_n(from, size, to);
+                detail::UninitializedCopyN(from, size, to);
             }
         }
 
@@ -310,4 +984,34 @@ namespace notstd {
         RawMemory<T> data_;
         size_t size_ = 0;
     };
+
+    // Destroys the elements of a released buffer and frees it the way Vector would have
+    template <typename T>
+    void DeleteReleased(const ReleasedBuffer<T>& buffer) noexcept {
+        std::destroy_n(buffer.data, buffer.size);
+        RawMemory<T>::Adopt(buffer.data, buffer.capacity, nullptr);
+    }
+
+    // Deleter for std::unique_ptr<T[], ReleasedDeleter<T>> owning a released buffer
+    template <typename T>
+    struct ReleasedDeleter {
+        size_t size = 0;
+        size_t capacity = 0;
+
+        void operator()(T* data) const noexcept {
+            DeleteReleased(ReleasedBuffer<T>{data, size, capacity});
+        }
+    };
+
+    // Copies a Vector built during constant evaluation into storage that may outlive it:
+    //     constexpr auto kTable = [] { Vector<int> v; ...; return ToArray<256>(v); }();
+    template <size_t N, typename T>
+    NOTSTD_CONSTEXPR std::array<T, N> ToArray(const Vector<T>& vector) {
+        assert(vector.Size() == N);
+        std::array<T, N> result{};
+        for (size_t i = 0; i < N; ++i) {
+            result[i] = vector[i];
+        }
+        return result;
+    }
 }//namespace notstd
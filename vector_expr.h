@@ -0,0 +1,232 @@
+#pragma once
+#include <cassert>
+#include <cstddef>
+#include <functional>
+#include <type_traits>
+
+#include "vector.h"
+
+namespace notstd {
+    // CRTP base of the lazy elementwise expressions. Nothing is computed until the
+    // expression is assigned to a Vector, which then runs one fused loop over all operands.
+    template <typename E>
+    class VectorExpression {
+    public:
+        const E& Self() const noexcept {
+            return static_cast<const E&>(*this);
+        }
+
+        size_t Size() const noexcept {
+            return Self().Size();
+        }
+
+        template <typename T>
+        void EvaluateTo(T* out) const {
+            const E& expr = Self();
+            const size_t size = expr.Size();
+            for (size_t i = 0; i < size; ++i) {
+                out[i] = static_cast<T>(expr[i]);
+            }
+        }
+    };
+
+    template <typename T>
+    class VectorRefExpression : public VectorExpression<VectorRefExpression<T>> {
+    public:
+        static constexpr bool is_scalar = false;
+
+        VectorRefExpression(const T* data, size_t size) noexcept
+            : data_(data)
+            , size_(size) {
+        }
+
+        size_t Size() const noexcept {
+            return size_;
+        }
+
+        T operator[](size_t index) const noexcept {
+            return data_[index];
+        }
+
+    private:
+        const T* data_;
+        size_t size_;
+    };
+
+    template <typename T>
+    class ScalarExpression : public VectorExpression<ScalarExpression<T>> {
+    public:
+        static constexpr bool is_scalar = true;
+
+        explicit ScalarExpression(T value) noexcept
+            : value_(value) {
+        }
+
+        size_t Size() const noexcept {
+            return 0;
+        }
+
+        T operator[](size_t) const noexcept {
+            return value_;
+        }
+
+    private:
+        T value_;
+    };
+
+    template <typename Op, typename L, typename R>
+    class BinaryExpression : public VectorExpression<BinaryExpression<Op, L, R>> {
+    public:
+        static constexpr bool is_scalar = L::is_scalar && R::is_scalar;
+
+        BinaryExpression(const L& lhs, const R& rhs) noexcept
+            : lhs_(lhs)
+            , rhs_(rhs) {
+            assert(L::is_scalar || R::is_scalar || lhs_.Size() == rhs_.Size());
+        }
+
+        size_t Size() const noexcept {
+            if constexpr (L::is_scalar) {
+                return rhs_.Size();
+            } else {
+                return lhs_.Size();
+            }
+        }
+
+        auto operator[](size_t index) const noexcept {
+            return Op{}(lhs_[index], rhs_[index]);
+        }
+
+    private:
+        // operands are held by value: leaves are a pointer or a scalar, so whole trees stay small
+        L lhs_;
+        R rhs_;
+    };
+
+    template <typename Op, typename E>
+    class UnaryExpression : public VectorExpression<UnaryExpression<Op, E>> {
+    public:
+        static constexpr bool is_scalar = E::is_scalar;
+
+        explicit UnaryExpression(const E& expr) noexcept
+            : expr_(expr) {
+        }
+
+        size_t Size() const noexcept {
+            return expr_.Size();
+        }
+
+        auto operator[](size_t index) const noexcept {
+            return Op{}(expr_[index]);
+        }
+
+    private:
+        E expr_;
+    };
+
+    namespace expr_detail {
+        template <typename X, typename = void>
+        struct Operand {
+            static constexpr bool is_operand = false;
+            static constexpr bool is_vector = false;
+        };
+
+        template <typename X>
+        struct Operand<X, std::enable_if_t<std::is_arithmetic_v<X>>> {
+            static constexpr bool is_operand = true;
+            static constexpr bool is_vector = false;
+
+            static ScalarExpression<X> Wrap(X value) noexcept {
+                return ScalarExpression<X>(value);
+            }
+        };
+
+        template <typename T>
+        struct Operand<Vector<T>, std::enable_if_t<std::is_arithmetic_v<T>>> {
+            static constexpr bool is_operand = true;
+            static constexpr bool is_vector = true;
+
+            static VectorRefExpression<T> Wrap(const Vector<T>& vector) noexcept {
+                return VectorRefExpression<T>(vector.Data(), vector.Size());
+            }
+        };
+
+        template <typename T>
+        struct Operand<Span<T>, std::enable_if_t<std::is_arithmetic_v<std::remove_const_t<T>>>> {
+            static constexpr bool is_operand = true;
+            static constexpr bool is_vector = true;
+
+            static VectorRefExpression<std::remove_const_t<T>> Wrap(Span<T> span) noexcept {
+                return VectorRefExpression<std::remove_const_t<T>>(span.Data(), span.Size());
+            }
+        };
+
+        template <typename X>
+        struct Operand<X, std::enable_if_t<std::is_base_of_v<VectorExpression<X>, X>>> {
+            static constexpr bool is_operand = true;
+            static constexpr bool is_vector = !X::is_scalar;
+
+            static const X& Wrap(const X& expr) noexcept {
+                return expr;
+            }
+        };
+
+        template <typename L, typename R>
+        inline constexpr bool is_binary_operands_v =
+            Operand<std::decay_t<L>>::is_operand && Operand<std::decay_t<R>>::is_operand
+            && (Operand<std::decay_t<L>>::is_vector || Operand<std::decay_t<R>>::is_vector);
+
+        template <typename Op, typename L, typename R>
+        auto MakeBinary(const L& lhs, const R& rhs) {
+            auto l = Operand<L>::Wrap(lhs);
+            auto r = Operand<R>::Wrap(rhs);
+            return BinaryExpression<Op, std::decay_t<decltype(l)>, std::decay_t<decltype(r)>>(l, r);
+        }
+    }//namespace expr_detail
+
+    template <typename L, typename R, typename = std::enable_if_t<expr_detail::is_binary_operands_v<L, R>>>
+    auto operator+(const L& lhs, const R& rhs) {
+        return expr_detail::MakeBinary<std::plus<>>(lhs, rhs);
+    }
+
+    template <typename L, typename R, typename = std::enable_if_t<expr_detail::is_binary_operands_v<L, R>>>
+    auto operator-(const L& lhs, const R& rhs) {
+        return expr_detail::MakeBinary<std::minus<>>(lhs, rhs);
+    }
+
+    template <typename L, typename R, typename = std::enable_if_t<expr_detail::is_binary_operands_v<L, R>>>
+    auto operator*(const L& lhs, const R& rhs) {
+        return expr_detail::MakeBinary<std::multiplies<>>(lhs, rhs);
+    }
+
+    template <typename L, typename R, typename = std::enable_if_t<expr_detail::is_binary_operands_v<L, R>>>
+    auto operator/(const L& lhs, const R& rhs) {
+        return expr_detail::MakeBinary<std::divides<>>(lhs, rhs);
+    }
+
+    template <typename X, typename = std::enable_if_t<expr_detail::Operand<X>::is_vector>>
+    auto operator-(const X& operand) {
+        auto e = expr_detail::Operand<X>::Wrap(operand);
+        return UnaryExpression<std::negate<>, std::decay_t<decltype(e)>>(e);
+    }
+
+    template <typename T, typename R, typename = std::enable_if_t<expr_detail::is_binary_operands_v<Vector<T>, R>>>
+    Vector<T>& operator+=(Vector<T>& lhs, const R& rhs) {
+        return lhs = lhs + rhs;
+    }
+
+    template <typename T, typename R, typename = std::enable_if_t<expr_detail::is_binary_operands_v<Vector<T>, R>>>
+    Vector<T>& operator-=(Vector<T>& lhs, const R& rhs) {
+        return lhs = lhs - rhs;
+    }
+
+    template <typename T, typename R, typename = std::enable_if_t<expr_detail::is_binary_operands_v<Vector<T>, R>>>
+    Vector<T>& operator*=(Vector<T>& lhs, const R& rhs) {
+        return lhs = lhs * rhs;
+    }
+
+    template <typename T, typename R, typename = std::enable_if_t<expr_detail::is_binary_operands_v<Vector<T>, R>>>
+    Vector<T>& operator/=(Vector<T>& lhs, const R& rhs) {
+        return lhs = lhs / rhs;
+    }
+}//namespace notstd
@@ -0,0 +1,290 @@
+#pragma once
+#include <cassert>
+#include <cerrno>
+#include <climits>
+#include <cstddef>
+#include <system_error>
+#include <type_traits>
+
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#if defined(__linux__)
+#include <fcntl.h>
+#endif
+
+#include "vector.h"
+
+namespace notstd {
+    // Smallest tail offered to a single read; below this the buffer grows first
+    inline constexpr size_t kMinReadChunk = 4096;
+
+    namespace io_detail {
+        template <typename T>
+        inline constexpr bool is_byte_like_v = sizeof(T) == 1 && std::is_trivially_copyable_v<T>;
+
+        [[noreturn]] inline void ThrowErrno(const char* what) {
+            throw std::system_error(errno, std::generic_category(), what);
+        }
+
+        inline bool WouldBlock(int error) noexcept {
+            return error == EAGAIN || error == EWOULDBLOCK;
+        }
+
+        // Bytes left in a regular file from the current offset, or 0 when unknown
+        inline size_t RemainingInFile(int fd) noexcept {
+            struct stat st;
+            if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+                return 0;
+            }
+            off_t position = lseek(fd, 0, SEEK_CUR);
+            if (position < 0 || position >= st.st_size) {
+                return 0;
+            }
+            return static_cast<size_t>(st.st_size - position);
+        }
+
+#if defined(IOV_MAX)
+        inline constexpr size_t kIovMax = IOV_MAX;
+#else
+        inline constexpr size_t kIovMax = 1024;
+#endif
+
+        template <typename T>
+        inline constexpr bool is_span_v = false;
+
+        template <typename T>
+        inline constexpr bool is_span_v<Span<T>> = true;
+
+        template <typename T>
+        Span<const std::byte> ByteView(const Vector<T>& vector) noexcept {
+            static_assert(std::is_trivially_copyable_v<T>, "only trivially copyable elements can be written raw");
+            static_assert(!is_span_v<T>, "pass a list of ranges as Span<const Span<const std::byte>>");
+            return AsBytes(vector.AsSpan());
+        }
+
+        template <typename T>
+        Span<const std::byte> ByteView(Span<T> span) noexcept {
+            static_assert(std::is_trivially_copyable_v<std::remove_const_t<T>>, "only trivially copyable elements can be written raw");
+            static_assert(!is_span_v<std::remove_const_t<T>>, "pass a list of ranges as Span<const Span<const std::byte>>");
+            return AsBytes(span);
+        }
+
+        // Writes every iovec in batches of at most kIovMax, resuming after partial writes.
+        // A negative offset writes at the file position (writev), otherwise pwritev.
+        // Stops early only when a non-blocking fd would block; returns the bytes written.
+        inline size_t WriteAll(int fd, iovec* iov, size_t count, off_t offset) {
+            size_t total = 0;
+            size_t first = 0;
+            while (first < count) {
+                if (iov[first].iov_len == 0) {
+                    ++first;
+                    continue;
+                }
+                int batch = static_cast<int>(count - first < kIovMax ? count - first : kIovMax);
+                ssize_t written = offset < 0
+                    ? writev(fd, iov + first, batch)
+                    : pwritev(fd, iov + first, batch, offset + static_cast<off_t>(total));
+                if (written < 0) {
+                    if (errno == EINTR) {
+                        continue;
+                    }
+                    if (WouldBlock(errno)) {
+                        break;
+                    }
+                    ThrowErrno(offset < 0 ? "WriteRangesTo: writev" : "WriteRangesTo: pwritev");
+                }
+                total += static_cast<size_t>(written);
+                size_t left = static_cast<size_t>(written);
+                while (first < count && left >= iov[first].iov_len) {
+                    left -= iov[first].iov_len;
+                    ++first;
+                }
+                if (left != 0) {
+                    iov[first].iov_base = static_cast<char*>(iov[first].iov_base) + left;
+                    iov[first].iov_len -= left;
+                }
+            }
+            return total;
+        }
+
+        inline size_t WriteRanges(int fd, Span<const Span<const std::byte>> ranges, off_t offset) {
+            Vector<iovec> iov;
+            iov.Reserve(ranges.Size());
+            for (Span<const std::byte> range : ranges) {
+                iov.PushBack(iovec{const_cast<std::byte*>(range.Data()), range.Size()});
+            }
+            return WriteAll(fd, iov.Data(), iov.Size(), offset);
+        }
+
+        template <typename T>
+        void GrowForRead(Vector<T>& buffer, size_t remaining) {
+            size_t capacity = buffer.Capacity();
+            size_t wanted = capacity * 2 > buffer.Size() + kMinReadChunk ? capacity * 2 : buffer.Size() + kMinReadChunk;
+            if (remaining != dynamic_extent && wanted > buffer.Size() + remaining) {
+                wanted = buffer.Size() + remaining;
+            }
+            buffer.Reserve(wanted);
+        }
+    }//namespace io_detail
+
+    // Reads from fd straight into the uninitialized tail of buffer until end of file,
+    // max_bytes have been appended, or a non-blocking fd has no more data. Capacity grows
+    // geometrically; for regular files the remaining size is reserved up front.
+    // Returns the number of bytes appended.
+    template <typename T>
+    size_t AppendFromFd(int fd, Vector<T>& buffer, size_t max_bytes = dynamic_extent) {
+        static_assert(io_detail::is_byte_like_v<T>, "AppendFromFd fills byte buffers");
+        if (size_t in_file = io_detail::RemainingInFile(fd); in_file != 0) {
+            size_t expected = in_file < max_bytes ? in_file : max_bytes;
+            // one spare byte lets the final read observe end of file without growing
+            buffer.Reserve(buffer.Size() + expected + (expected < max_bytes ? 1 : 0));
+        }
+        size_t appended = 0;
+        while (appended < max_bytes) {
+            size_t remaining = max_bytes == dynamic_extent ? dynamic_extent : max_bytes - appended;
+            if (buffer.SpareCapacity().Empty()) {
+                io_detail::GrowForRead(buffer, remaining);
+            }
+            Span<T> spare = buffer.SpareCapacity();
+            size_t request = spare.Size() < remaining ? spare.Size() : remaining;
+            ssize_t got = read(fd, spare.Data(), request);
+            if (got < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                if (io_detail::WouldBlock(errno)) {
+                    break;
+                }
+                io_detail::ThrowErrno("AppendFromFd: read");
+            }
+            if (got == 0) {
+                break;
+            }
+            buffer.CommitAppend(static_cast<size_t>(got));
+            appended += static_cast<size_t>(got);
+        }
+        return appended;
+    }
+
+    // Performs a single read into the spare capacity of buffer, first growing it so that
+    // at least min_spare bytes are available. Returns the bytes appended (0 at end of file
+    // or when a non-blocking fd has no data).
+    template <typename T>
+    size_t ReadInto(int fd, Vector<T>& buffer, size_t min_spare = kMinReadChunk) {
+        static_assert(io_detail::is_byte_like_v<T>, "ReadInto fills byte buffers");
+        if (buffer.SpareCapacity().Size() < min_spare) {
+            buffer.Reserve(buffer.Capacity() * 2 > buffer.Size() + min_spare ? buffer.Capacity() * 2 : buffer.Size() + min_spare);
+        }
+        Span<T> spare = buffer.SpareCapacity();
+        for (;;) {
+            ssize_t got = read(fd, spare.Data(), spare.Size());
+            if (got >= 0) {
+                buffer.CommitAppend(static_cast<size_t>(got));
+                return static_cast<size_t>(got);
+            }
+            if (errno == EINTR) {
+                continue;
+            }
+            if (io_detail::WouldBlock(errno)) {
+                return 0;
+            }
+            io_detail::ThrowErrno("ReadInto: read");
+        }
+    }
+
+    // Scatters a single readv across the spare capacity of several buffers in order,
+    // e.g. a fixed-size header followed by a body. Buffers are not grown; reserve first.
+    template <typename... Ts>
+    size_t ReadInto(int fd, Vector<Ts>&... buffers) {
+        static_assert(sizeof...(Ts) > 1, "use ReadInto(fd, buffer, min_spare) for a single buffer");
+        static_assert((io_detail::is_byte_like_v<Ts> && ...), "ReadInto fills byte buffers");
+        iovec iov[sizeof...(Ts)] = {iovec{buffers.SpareCapacity().Data(), buffers.SpareCapacity().Size()}...};
+        ssize_t got;
+        do {
+            got = readv(fd, iov, static_cast<int>(sizeof...(Ts)));
+        } while (got < 0 && errno == EINTR);
+        if (got < 0) {
+            if (io_detail::WouldBlock(errno)) {
+                return 0;
+            }
+            io_detail::ThrowErrno("ReadInto: readv");
+        }
+        size_t left = static_cast<size_t>(got);
+        auto commit = [&left](auto& buffer) {
+            size_t part = buffer.SpareCapacity().Size() < left ? buffer.SpareCapacity().Size() : left;
+            buffer.CommitAppend(part);
+            left -= part;
+        };
+        (commit(buffers), ...);
+        return static_cast<size_t>(got);
+    }
+    // Writes an arbitrary number of byte ranges with as few writev calls as IOV_MAX allows
+    inline size_t WriteRangesTo(int fd, Span<const Span<const std::byte>> ranges) {
+        return io_detail::WriteRanges(fd, ranges, -1);
+    }
+
+    inline size_t WriteRangesTo(int fd, Span<Span<const std::byte>> ranges) {
+        return io_detail::WriteRanges(fd, ranges, -1);
+    }
+
+    inline size_t PWriteRangesTo(int fd, off_t offset, Span<const Span<const std::byte>> ranges) {
+        assert(offset >= 0);
+        return io_detail::WriteRanges(fd, ranges, offset);
+    }
+
+    inline size_t PWriteRangesTo(int fd, off_t offset, Span<Span<const std::byte>> ranges) {
+        assert(offset >= 0);
+        return io_detail::WriteRanges(fd, ranges, offset);
+    }
+
+    // Writes the contents of several Vectors or Spans of trivially copyable elements, in order,
+    // with a single writev where possible. Partial writes are resumed; returns the bytes written,
+    // which is less than the total only if a non-blocking fd would block.
+    template <typename... Ranges>
+    size_t WriteRangesTo(int fd, const Ranges&... ranges) {
+        iovec iov[] = {iovec{const_cast<std::byte*>(io_detail::ByteView(ranges).Data()), io_detail::ByteView(ranges).Size()}...};
+        return io_detail::WriteAll(fd, iov, sizeof...(Ranges), -1);
+    }
+
+    template <typename... Ranges>
+    size_t PWriteRangesTo(int fd, off_t offset, const Ranges&... ranges) {
+        assert(offset >= 0);
+        iovec iov[] = {iovec{const_cast<std::byte*>(io_detail::ByteView(ranges).Data()), io_detail::ByteView(ranges).Size()}...};
+        return io_detail::WriteAll(fd, iov, sizeof...(Ranges), offset);
+    }
+
+    template <typename T>
+    size_t WriteTo(int fd, const Vector<T>& vector) {
+        return WriteRangesTo(fd, vector);
+    }
+
+#if defined(__linux__)
+    // Maps the pages of range into a pipe with vmsplice, from where splice(2) can move them on
+    // without another copy. The memory must not be modified until the pipe has been drained.
+    template <typename T>
+    size_t SpliceTo(int pipe_fd, Span<T> range) {
+        Span<const std::byte> bytes = io_detail::ByteView(range);
+        iovec iov{const_cast<std::byte*>(bytes.Data()), bytes.Size()};
+        size_t total = 0;
+        while (iov.iov_len != 0) {
+            ssize_t moved = vmsplice(pipe_fd, &iov, 1, 0);
+            if (moved < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                if (io_detail::WouldBlock(errno)) {
+                    break;
+                }
+                io_detail::ThrowErrno("SpliceTo: vmsplice");
+            }
+            iov.iov_base = static_cast<char*>(iov.iov_base) + moved;
+            iov.iov_len -= static_cast<size_t>(moved);
+            total += static_cast<size_t>(moved);
+        }
+        return total;
+    }
+#endif
+}//namespace notstd
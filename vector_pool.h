@@ -0,0 +1,209 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+#include "vector.h"
+
+namespace notstd {
+    struct VectorPoolOptions {
+        // Total capacity, in bytes, the pool may hold on to; recycled vectors beyond it are freed
+        size_t max_retained_bytes = size_t(64) << 20;
+        // Vectors larger than this are never retained
+        size_t max_vector_bytes = size_t(4) << 20;
+        // Independently locked free lists; threads pick one by hashing their id. 0 uses one per core.
+        size_t shards = 0;
+    };
+
+    // Recycles empty vectors together with their capacity, so objects that each grow a
+    // vector to a similar size and then die stop paying for the allocate-and-double sequence
+    // every time. Free vectors are kept in power-of-two capacity classes.
+    //
+    // Retained vectors stay charged to the MemoryBudget they were allocated under.
+    template <typename T>
+    class VectorPool {
+    public:
+        struct Stats {
+            size_t hits = 0;
+            size_t misses = 0;
+            size_t dropped = 0;
+        };
+
+        explicit VectorPool(VectorPoolOptions options = {})
+            : options_(options)
+            , shards_(ShardCount(options.shards)) {
+        }
+
+        VectorPool(const VectorPool&) = delete;
+        VectorPool& operator=(const VectorPool&) = delete;
+
+        // An empty vector with room for at least min_capacity elements, recycled if possible.
+        // Looks in the calling thread's shard and kStealShards neighbours first; vectors
+        // recycled by other threads land in their shards, so on a miss the remaining non-empty
+        // shards are swept with try_lock, skipping any that another thread holds.
+        Vector<T> Acquire(size_t min_capacity = 0) {
+            size_t home = HomeShard();
+            size_t probes = shards_.Size() < kStealShards + 1 ? shards_.Size() : kStealShards + 1;
+            Vector<T> result;
+            for (size_t i = 0; i < probes; ++i) {
+                Shard& shard = shards_[(home + i) % shards_.Size()];
+                std::lock_guard lock(shard.mutex);
+                if (TryTake(shard, min_capacity, result)) {
+                    return Hit(std::move(result));
+                }
+            }
+            for (size_t i = probes; i < shards_.Size(); ++i) {
+                Shard& shard = shards_[(home + i) % shards_.Size()];
+                if (shard.count.load(std::memory_order_relaxed) == 0) {
+                    continue;
+                }
+                std::unique_lock lock(shard.mutex, std::try_to_lock);
+                if (lock.owns_lock() && TryTake(shard, min_capacity, result)) {
+                    return Hit(std::move(result));
+                }
+            }
+            misses_.fetch_add(1, std::memory_order_relaxed);
+            result.Reserve(min_capacity);
+            return result;
+        }
+
+        // Clears vector and keeps its buffer for a later Acquire, unless that would exceed the
+        // retention limits, in which case the buffer is freed
+        void Recycle(Vector<T>&& vector) noexcept {
+            Vector<T> local = std::move(vector);
+            local.Clear();
+            size_t bytes = local.Capacity() * sizeof(T);
+            if (bytes == 0) {
+                return;
+            }
+            if (bytes > options_.max_vector_bytes || !TryRetain(bytes)) {
+                dropped_.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+            Shard& shard = shards_[HomeShard()];
+            std::lock_guard lock(shard.mutex);
+            try {
+                shard.free[ClassOf(local.Capacity())].PushBack(std::move(local));
+                shard.count.fetch_add(1, std::memory_order_relaxed);
+            } catch (...) {
+                // the free list itself could not grow; dropping the buffer is always safe
+                retained_bytes_.fetch_sub(bytes, std::memory_order_relaxed);
+                dropped_.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+
+        // Frees every retained buffer
+        void Trim() noexcept {
+            for (Shard& shard : shards_) {
+                std::lock_guard lock(shard.mutex);
+                for (Vector<Vector<T>>& free : shard.free) {
+                    for (const Vector<T>& vector : free) {
+                        retained_bytes_.fetch_sub(vector.Capacity() * sizeof(T), std::memory_order_relaxed);
+                    }
+                    free = Vector<Vector<T>>();
+                }
+                shard.count.store(0, std::memory_order_relaxed);
+            }
+        }
+
+        size_t RetainedBytes() const noexcept {
+            return retained_bytes_.load(std::memory_order_relaxed);
+        }
+
+        Stats GetStats() const noexcept {
+            return Stats{hits_.load(std::memory_order_relaxed), misses_.load(std::memory_order_relaxed),
+                         dropped_.load(std::memory_order_relaxed)};
+        }
+
+    private:
+        static constexpr size_t kClasses = sizeof(size_t) * 8;
+        static constexpr size_t kStealShards = 1;
+        // A request is served from its own capacity class or the next one up, so a small
+        // Acquire never walks off with a buffer many times larger than it asked for
+        static constexpr size_t kClassSlack = 1;
+
+        struct alignas(64) Shard {
+            std::mutex mutex;
+            // Free vectors in this shard; read without the lock to skip empty shards
+            std::atomic<size_t> count{0};
+            std::array<Vector<Vector<T>>, kClasses> free;
+        };
+
+        // Class k holds capacities in [2^k, 2^(k+1))
+        static size_t ClassOf(size_t capacity) noexcept {
+            if (capacity <= 1) {
+                return 0;
+            }
+#if defined(__GNUC__) || defined(__clang__)
+            return sizeof(unsigned long long) * 8 - 1 - __builtin_clzll(capacity);
+#else
+            size_t result = 0;
+            while (capacity >>= 1) {
+                ++result;
+            }
+            return result;
+#endif
+        }
+
+        // Moves the smallest-class free vector with at least min_capacity into result. The
+        // caller holds shard.mutex.
+        static bool TryTake(Shard& shard, size_t min_capacity, Vector<T>& result) noexcept {
+            size_t first = ClassOf(min_capacity);
+            size_t last = first + kClassSlack < kClasses ? first + kClassSlack : kClasses - 1;
+            for (size_t size_class = first; size_class <= last; ++size_class) {
+                Vector<Vector<T>>& free = shard.free[size_class];
+                for (size_t k = free.Size(); k-- > 0;) {
+                    if (free[k].Capacity() >= min_capacity) {
+                        result = std::move(free[k]);
+                        if (k + 1 != free.Size()) {
+                            free[k] = std::move(free[free.Size() - 1]);
+                        }
+                        free.PopBack();
+                        shard.count.fetch_sub(1, std::memory_order_relaxed);
+                        return true;
+                    }
+                }
+            }
+            return false;
+        }
+
+        Vector<T> Hit(Vector<T>&& result) noexcept {
+            retained_bytes_.fetch_sub(result.Capacity() * sizeof(T), std::memory_order_relaxed);
+            hits_.fetch_add(1, std::memory_order_relaxed);
+            return std::move(result);
+        }
+
+        static size_t ShardCount(size_t requested) noexcept {
+            if (requested == 0) {
+                requested = std::thread::hardware_concurrency();
+            }
+            return requested != 0 ? requested : 1;
+        }
+
+        size_t HomeShard() const noexcept {
+            static thread_local size_t thread_hash = std::hash<std::thread::id>()(std::this_thread::get_id());
+            return thread_hash % shards_.Size();
+        }
+
+        bool TryRetain(size_t bytes) noexcept {
+            size_t retained = retained_bytes_.load(std::memory_order_relaxed);
+            do {
+                if (retained > options_.max_retained_bytes || bytes > options_.max_retained_bytes - retained) {
+                    return false;
+                }
+            } while (!retained_bytes_.compare_exchange_weak(retained, retained + bytes, std::memory_order_relaxed));
+            return true;
+        }
+
+    private:
+        VectorPoolOptions options_;
+        Vector<Shard> shards_;
+        std::atomic<size_t> retained_bytes_{0};
+        std::atomic<size_t> hits_{0};
+        std::atomic<size_t> misses_{0};
+        std::atomic<size_t> dropped_{0};
+    };
+}//namespace notstd
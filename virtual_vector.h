@@ -0,0 +1,285 @@
+#pragma once
+#include <cassert>
+#include <cerrno>
+#include <cstddef>
+#include <memory>
+#include <stdexcept>
+#include <system_error>
+#include <utility>
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "vector.h"
+
+namespace notstd {
+    struct VirtualVectorOptions {
+        // Address space reserved up front; bounds the capacity. Costs no memory until committed.
+        size_t reserve_bytes = size_t(64) << 30;
+        // Bytes made accessible at a time as the vector grows, rounded up to whole pages
+        size_t commit_bytes = size_t(64) << 10;
+    };
+
+    // Contiguous growable array that never relocates. The first EmplaceBack reserves
+    // reserve_bytes of address space with PROT_NONE; growing only mprotects the next pages
+    // read-write, so elements are never moved and pointers, references and spans stay valid
+    // until the element is destroyed. The price is a fixed maximum size and POSIX-only mmap.
+    //
+    // With NOTSTD_MEMORY_BUDGET, committed bytes are charged to the MemoryBudget current at
+    // construction.
+    template <typename T>
+    class VirtualVector {
+        static_assert(alignof(T) <= 4096, "elements are placed at page granularity");
+
+    public:
+        using iterator = T*;
+        using const_iterator = const T*;
+
+        explicit VirtualVector(VirtualVectorOptions options = {}) noexcept
+            : options_(options)
+            , budget_(NOTSTD_MEMORY_BUDGET ? MemoryBudget::Current() : nullptr) {
+        }
+
+        VirtualVector(const VirtualVector&) = delete;
+        VirtualVector& operator=(const VirtualVector&) = delete;
+
+        VirtualVector(VirtualVector&& other) noexcept
+            : options_(other.options_)
+            , budget_(other.budget_)
+            , data_(std::exchange(other.data_, nullptr))
+            , size_(std::exchange(other.size_, 0))
+            , committed_bytes_(std::exchange(other.committed_bytes_, 0))
+            , reserved_bytes_(std::exchange(other.reserved_bytes_, 0)) {
+        }
+
+        VirtualVector& operator=(VirtualVector&& rhs) noexcept {
+            if (this != &rhs) {
+                Unmap();
+                options_ = rhs.options_;
+                budget_ = rhs.budget_;
+                data_ = std::exchange(rhs.data_, nullptr);
+                size_ = std::exchange(rhs.size_, 0);
+                committed_bytes_ = std::exchange(rhs.committed_bytes_, 0);
+                reserved_bytes_ = std::exchange(rhs.reserved_bytes_, 0);
+            }
+            return *this;
+        }
+
+        ~VirtualVector() {
+            Unmap();
+        }
+
+        iterator begin() noexcept {
+            return data_;
+        }
+
+        iterator end() noexcept {
+            return data_ + size_;
+        }
+
+        const_iterator begin() const noexcept {
+            return data_;
+        }
+
+        const_iterator end() const noexcept {
+            return data_ + size_;
+        }
+
+        template <typename... Args>
+        T& EmplaceBack(Args&&... args) {
+            if (size_ == Capacity()) {
+                Commit(size_ + 1);
+            }
+            T* result = detail::ConstructAt(data_ + size_, std::forward<Args>(args)...);
+            ++size_;
+            return *result;
+        }
+
+        template <typename V>
+        void PushBack(V&& value) {
+            EmplaceBack(std::forward<V>(value));
+        }
+
+        void PopBack() noexcept {
+            assert(size_ != 0);
+            std::destroy_at(data_ + --size_);
+        }
+
+        // Commits room for at least capacity elements; never moves anything
+        void Reserve(size_t capacity) {
+            if (capacity > Capacity()) {
+                Commit(capacity);
+            }
+        }
+
+        // Destroys all elements but keeps the committed pages
+        void Clear() noexcept {
+            std::destroy_n(data_, size_);
+            size_ = 0;
+        }
+
+        // Returns the pages past the last element to the OS and makes them inaccessible
+        // again; the address space stays reserved
+        void ShrinkToFit() noexcept {
+            size_t keep = RoundUp(size_ * sizeof(T), PageSize());
+            if (keep >= committed_bytes_) {
+                return;
+            }
+            char* first = reinterpret_cast<char*>(data_) + keep;
+            size_t bytes = committed_bytes_ - keep;
+            // mapping fresh PROT_NONE pages over the tail drops its contents in one call,
+            // leaving it as if never committed; on failure the pages just stay committed
+            if (mmap(first, bytes, PROT_NONE, kMapFlags | MAP_FIXED, -1, 0) == MAP_FAILED) {
+                return;
+            }
+            if (budget_ != nullptr) {
+                budget_->Release(bytes);
+            }
+            committed_bytes_ = keep;
+        }
+
+        const T& operator[](size_t index) const noexcept {
+            return const_cast<VirtualVector&>(*this)[index];
+        }
+
+        T& operator[](size_t index) noexcept {
+#if NOTSTD_HARDENED
+            if (index >= size_) {
+                detail::HardeningFailure("VirtualVector index out of range");
+            }
+#endif
+            assert(index < size_);
+            return data_[index];
+        }
+
+        T& Back() noexcept {
+            return (*this)[size_ - 1];
+        }
+
+        const T& Back() const noexcept {
+            return (*this)[size_ - 1];
+        }
+
+        T* Data() noexcept {
+            return data_;
+        }
+
+        const T* Data() const noexcept {
+            return data_;
+        }
+
+        Span<T> AsSpan() noexcept {
+            return Span<T>(data_, size_);
+        }
+
+        Span<const T> AsSpan() const noexcept {
+            return Span<const T>(data_, size_);
+        }
+
+        operator Span<T>() noexcept {
+            return AsSpan();
+        }
+
+        operator Span<const T>() const noexcept {
+            return AsSpan();
+        }
+
+        size_t Size() const noexcept {
+            return size_;
+        }
+
+        bool Empty() const noexcept {
+            return size_ == 0;
+        }
+
+        // Elements that fit in the committed pages
+        size_t Capacity() const noexcept {
+            return committed_bytes_ / sizeof(T);
+        }
+
+        // Elements that fit in the reservation
+        size_t MaxSize() const noexcept {
+            return options_.reserve_bytes / sizeof(T);
+        }
+
+        size_t CommittedBytes() const noexcept {
+            return committed_bytes_;
+        }
+
+    private:
+#if defined(MAP_NORESERVE)
+        static constexpr int kMapFlags = MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE;
+#else
+        static constexpr int kMapFlags = MAP_PRIVATE | MAP_ANONYMOUS;
+#endif
+
+        static size_t PageSize() noexcept {
+            static const size_t page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+            return page_size;
+        }
+
+        static size_t RoundUp(size_t value, size_t multiple) noexcept {
+            return (value + multiple - 1) / multiple * multiple;
+        }
+
+        // Makes the pages holding the first capacity elements accessible, committing at
+        // least commit_bytes at a time. Reserves the address space on first use.
+        void Commit(size_t capacity) {
+            if (capacity > MaxSize()) {
+                throw std::length_error("VirtualVector reservation exhausted");
+            }
+            if (data_ == nullptr) {
+                ReserveAddressSpace();
+            }
+            size_t step = RoundUp(options_.commit_bytes != 0 ? options_.commit_bytes : 1, PageSize());
+            size_t target = RoundUp(capacity * sizeof(T), step);
+            target = target < reserved_bytes_ ? target : reserved_bytes_;
+            size_t bytes = target - committed_bytes_;
+            if (budget_ != nullptr) {
+                budget_->Charge(bytes);
+            }
+            if (mprotect(reinterpret_cast<char*>(data_) + committed_bytes_, bytes, PROT_READ | PROT_WRITE) != 0) {
+                int error = errno;
+                if (budget_ != nullptr) {
+                    budget_->Release(bytes);
+                }
+                if (error == ENOMEM) {
+                    throw std::bad_alloc();
+                }
+                throw std::system_error(error, std::generic_category(), "VirtualVector mprotect");
+            }
+            committed_bytes_ = target;
+        }
+
+        void ReserveAddressSpace() {
+            size_t bytes = RoundUp(options_.reserve_bytes, PageSize());
+            void* base = mmap(nullptr, bytes, PROT_NONE, kMapFlags, -1, 0);
+            if (base == MAP_FAILED) {
+                throw std::system_error(errno, std::generic_category(), "VirtualVector mmap");
+            }
+            data_ = static_cast<T*>(base);
+            reserved_bytes_ = bytes;
+        }
+
+        void Unmap() noexcept {
+            if (data_ == nullptr) {
+                return;
+            }
+            Clear();
+            if (budget_ != nullptr) {
+                budget_->Release(committed_bytes_);
+            }
+            munmap(data_, reserved_bytes_);
+            data_ = nullptr;
+            committed_bytes_ = reserved_bytes_ = 0;
+        }
+
+    private:
+        VirtualVectorOptions options_;
+        MemoryBudget* budget_;
+        T* data_ = nullptr;
+        size_t size_ = 0;
+        size_t committed_bytes_ = 0;
+        size_t reserved_bytes_ = 0;
+    };
+}//namespace notstd